@@ -12,8 +12,6 @@
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
 /* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +79,30 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts a one-shot countdown of COUNT input clock cycles (at
+   PIT_HZ) on CHANNEL.  Channel 0 raises its interrupt once when
+   the count runs out, and then stays quiet until started again.
+   COUNT is clamped to 1...65535.
+
+   This is mode 0, "interrupt on terminal count".  Loading a new
+   count restarts the countdown, whether or not the previous one
+   finished. */
+void
+pit_start_oneshot (int channel, unsigned count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  if (count < 1)
+    count = 1;
+  else if (count > 0xffff)
+    count = 0xffff;
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
@@ -3,6 +3,10 @@
 
 #include <stdint.h>
 
+/* Frequency of the PIT's input clock, in Hz. */
+#define PIT_HZ 1193180
+
 void pit_configure_channel (int channel, int mode, int frequency);
+void pit_start_oneshot (int channel, unsigned count);
 
 #endif /* devices/pit.h */
@@ -5,6 +5,11 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/irqsoff.h"
+#include "threads/lockstat.h"
+#include "threads/phase.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -130,6 +135,17 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+#ifdef LOCKSTAT
+  lockstat_print_stats ();
+#endif
+#ifdef IRQSOFF
+  irqsoff_print_stats ();
+#endif
+#ifdef PROFILE
+  profile_print_stats ();
+#endif
+  trace_print_stats ();
+  phase_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -9,6 +9,7 @@
 #include "threads/thread.h"
 #include "threads/fixed-point.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
   
@@ -23,13 +24,46 @@
 
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
+/* Lets timer_ticks() read the 64-bit ticks without turning interrupts off. */
+static struct seqlock ticks_seq;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Number of clock_cycles() per second.
+   Initialized by timer_calibrate(). */
+static uint64_t cycles_per_sec;
+
+/* Timer ticks to count cycles over when calibrating. */
+#define CLOCK_CALIBRATE_TICKS 5
+
+/* Tickless mode.  The PIT interrupts only when the first sleeper
+   is due or the running thread's time slice ends, whichever is
+   sooner, and not at all if neither is pending.  Ticks are then
+   counted from clock_cycles() instead of from interrupts. */
+bool timer_tickless;
+static bool oneshot;            /* PIT in one-shot mode? */
+static int64_t base_ticks;      /* Ticks when one-shot mode started. */
+static uint64_t base_cycles;    /* clock_cycles() at that moment. */
+static uint64_t cycles_per_tick;
+static uint64_t max_oneshot;    /* Longest one-shot count, in cycles. */
+static uint64_t armed_at;       /* clock_cycles() of the next interrupt. */
+static uint64_t slice_end;      /* End of the running thread's slice. */
+static int64_t oneshot_cnt;     /* Number of one-shot interrupts. */
+
+/* Sleeps shorter than this many microseconds spin on the clock
+   in tickless mode, since blocking would take about as long. */
+#define ONESHOT_MIN_SLEEP_US 20
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
+static void calibrate_clock (void);
+static void start_oneshot (void);
+static void oneshot_interrupt (struct intr_frame *);
+static void set_next_interrupt (void);
+static void arm (uint64_t when);
+static void sleep_until (int64_t wake);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
@@ -39,11 +73,13 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void) 
 {
+  seqlock_init (&ticks_seq);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and the rate of clock_cycles(). */
 void
 timer_calibrate (void) 
 {
@@ -67,16 +103,88 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  calibrate_clock ();
+  printf ("%'"PRIu64" loops/s, %'"PRIu64" cycles/s.\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, cycles_per_sec);
+
+  /* The multilevel feedback queue scheduler recomputes
+     priorities on every tick, so it keeps the periodic timer. */
+  if (timer_tickless && !thread_mlfqs && cycles_per_sec > 0)
+    start_oneshot ();
+  else
+    timer_tickless = false;
+}
+
+/* Counts clock_cycles() across a few timer ticks to find how
+   many there are per second. */
+static void
+calibrate_clock (void)
+{
+  int64_t start;
+  uint64_t cycles;
+
+  /* Wait for a timer tick. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  cycles = clock_cycles ();
+  start = ticks;
+  while (ticks - start < CLOCK_CALIBRATE_TICKS)
+    barrier ();
+  cycles = clock_cycles () - cycles;
+
+  cycles_per_sec = cycles * TIMER_FREQ / CLOCK_CALIBRATE_TICKS;
+}
+
+/* Returns the number of clock_cycles() per second, or 0 before
+   timer_calibrate(). */
+uint64_t
+clock_hz (void)
+{
+  return cycles_per_sec;
+}
+
+/* Returns the number of nanoseconds since reset, according to
+   clock_cycles().  Returns 0 before timer_calibrate(). */
+uint64_t
+clock_ns (void)
+{
+  return clock_cycles_to_ns (clock_cycles ());
+}
+
+/* Converts CYCLES of clock_cycles() into nanoseconds.  Returns 0
+   before timer_calibrate(). */
+uint64_t
+clock_cycles_to_ns (uint64_t cycles)
+{
+  const uint64_t ns_per_sec = 1000 * 1000 * 1000;
+
+  if (cycles_per_sec == 0)
+    return 0;
+
+  /* Whole seconds and the rest apart, so that multiplying by
+     ns_per_sec cannot overflow. */
+  return (cycles / cycles_per_sec * ns_per_sec
+          + cycles % cycles_per_sec * ns_per_sec / cycles_per_sec);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned seq;
+  int64_t t;
+
+  if (oneshot)
+    return base_ticks + (clock_cycles () - base_cycles) / cycles_per_tick;
+
+  do
+    {
+      seq = seqlock_read_begin (&ticks_seq);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seq, seq));
   return t;
 }
 
@@ -94,7 +202,43 @@ void
 timer_sleep (int64_t ticks) 
 {
   ASSERT (intr_get_level () == INTR_ON);
-  insert_in_waiting_list(ticks);
+  if (oneshot)
+    sleep_until (clock_cycles () + ticks * (int64_t) cycles_per_tick);
+  else
+    sleep_until (timer_ticks () + ticks);
+}
+
+/* Sleeps until timer_ticks() reaches TICK.  Returns at once if
+   it already has.  May be called with interrupts off, but not
+   from an interrupt handler. */
+void
+timer_sleep_until (int64_t tick)
+{
+  ASSERT (!intr_context ());
+  if (tick <= timer_ticks ())
+    return;
+  if (oneshot)
+    sleep_until (base_cycles + (tick - base_ticks) * (int64_t) cycles_per_tick);
+  else
+    sleep_until (tick);
+}
+
+/* Returns the timer time at which timer_ticks() reaches TICK, in
+   the units of the sleep list: TICK itself, or a clock_cycles()
+   value in tickless mode, where the timer is also set to
+   interrupt by then.  Interrupts must be off. */
+int64_t
+timer_wake_time (int64_t tick)
+{
+  int64_t wake;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (!oneshot)
+    return tick;
+  wake = base_cycles + (tick - base_ticks) * (int64_t) cycles_per_tick;
+  if ((uint64_t) wake < armed_at)
+    arm (wake);
+  return wake;
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -164,7 +308,31 @@ timer_ndelay (int64_t ns)
 void
 timer_print_stats (void) 
 {
-  printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %"PRId64" ticks", timer_ticks ());
+  if (oneshot)
+    printf (", %"PRId64" one-shot interrupts", oneshot_cnt);
+  printf ("\n");
+}
+
+/* Starts a time slice of TICKS timer ticks for the thread about
+   to run, or none if TICKS is 0.  In tickless mode this makes
+   sure the timer interrupts when the slice ends.  Interrupts
+   must be off. */
+void
+timer_start_slice (int64_t ticks)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!oneshot)
+    return;
+  if (ticks == 0)
+    {
+      slice_end = UINT64_MAX;
+      return;
+    }
+  slice_end = clock_cycles () + ticks * cycles_per_tick;
+  if (slice_end < armed_at)
+    arm (slice_end);
 }
 
 //
@@ -172,7 +340,18 @@ timer_print_stats (void)
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  if (oneshot)
+    {
+      oneshot_interrupt (args);
+      return;
+    }
+
+  enum intr_level old_level = seqlock_write_begin (&ticks_seq);
   ticks++;
+  seqlock_write_end (&ticks_seq, old_level);
+#ifdef PROFILE
+  profile_sample (args);
+#endif
   thread_tick ();
   remover_thread_durmiente(ticks);    /* Removes a thread from the wait_sleeping_list. */
 
@@ -200,6 +379,105 @@ timer_interrupt (struct intr_frame *args UNUSED)
 
 }
 
+/* Switches the PIT to one-shot mode.  Called once, at the end of
+   timer_calibrate(), which needs the periodic ticks. */
+static void
+start_oneshot (void)
+{
+  enum intr_level old_level = intr_disable ();
+
+  cycles_per_tick = cycles_per_sec / TIMER_FREQ;
+  max_oneshot = 0xffff * cycles_per_sec / PIT_HZ;
+  base_ticks = ticks;
+  base_cycles = clock_cycles ();
+  slice_end = UINT64_MAX;
+  oneshot = true;
+
+  /* Stop the periodic interrupt with one more, a tick from now,
+     which sets the next one properly. */
+  armed_at = UINT64_MAX;
+  arm (base_cycles + cycles_per_tick);
+  intr_set_level (old_level);
+
+  /* Give the running thread a time slice. */
+  thread_yield ();
+}
+
+/* Timer interrupt handler in one-shot mode.  Brings the tick
+   count up to date, wakes up the sleepers that are due and sets
+   the next interrupt. */
+static void
+oneshot_interrupt (struct intr_frame *args UNUSED)
+{
+  uint64_t now = clock_cycles ();
+  int64_t elapsed;
+  bool slice_over;
+
+  oneshot_cnt++;
+  elapsed = base_ticks + (now - base_cycles) / cycles_per_tick - ticks;
+  ticks += elapsed;
+  armed_at = UINT64_MAX;
+#ifdef PROFILE
+  profile_sample (args);
+#endif
+
+  /* The next thread to run starts its own slice. */
+  slice_over = now >= slice_end;
+  if (slice_over)
+    slice_end = UINT64_MAX;
+  thread_tick_oneshot (elapsed, slice_over);
+  remover_thread_durmiente (now);
+  set_next_interrupt ();
+}
+
+/* Sets the one-shot timer for the first sleeper or the end of
+   the time slice, whichever comes first.  If there is neither,
+   leaves it off until one turns up. */
+static void
+set_next_interrupt (void)
+{
+  uint64_t next = slice_end;
+  int64_t wake = thread_next_wakeup ();
+
+  if (wake != INT64_MAX && (uint64_t) wake < next)
+    next = wake;
+  if (next != UINT64_MAX)
+    arm (next);
+}
+
+/* Programs the PIT to interrupt at clock_cycles() time WHEN.  The
+   PIT's 16-bit counter reaches only about 55 ms ahead; an earlier
+   interrupt then just sets the next one. */
+static void
+arm (uint64_t when)
+{
+  uint64_t now = clock_cycles ();
+  uint64_t delta = when > now ? when - now : 0;
+
+  if (delta > max_oneshot)
+    {
+      delta = max_oneshot;
+      when = now + delta;
+    }
+
+  /* Round up so as not to interrupt before WHEN. */
+  pit_start_oneshot (0, (delta * PIT_HZ + cycles_per_sec - 1)
+                        / cycles_per_sec);
+  armed_at = when;
+}
+
+/* Puts the current thread to sleep until timer time WAKE, which
+   is a tick count, or a clock_cycles() value in tickless mode. */
+static void
+sleep_until (int64_t wake)
+{
+  enum intr_level old_level = intr_disable ();
+  if (oneshot && (uint64_t) wake < armed_at)
+    arm (wake);
+  insert_in_waiting_list (wake);
+  intr_set_level (old_level);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -246,7 +524,25 @@ real_time_sleep (int64_t num, int32_t denom)
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
-  if (ticks > 0)
+  if (oneshot)
+    {
+      /* The one-shot timer can wake us up at any time, so sleep
+         for exactly that long, or spin if it is too short to be
+         worth blocking. */
+      uint64_t start = clock_cycles ();
+      uint64_t cycles;
+
+      if (num <= 0)
+        return;
+      cycles = (num / denom * cycles_per_sec
+                + num % denom * cycles_per_sec / denom);
+      if (cycles < ONESHOT_MIN_SLEEP_US * cycles_per_sec / (1000 * 1000))
+        while (clock_cycles () - start < cycles)
+          barrier ();
+      else
+        sleep_until (start + cycles);
+    }
+  else if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
@@ -2,19 +2,27 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Program the timer one-shot instead of periodic?  Set by the
+   -tickless option. */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
+void timer_start_slice (int64_t ticks);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
+void timer_sleep_until (int64_t tick);
+int64_t timer_wake_time (int64_t tick);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
@@ -26,4 +34,20 @@ void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* High-resolution clock, in CPU cycles since reset.  Reads the
+   time-stamp counter, so it costs a few cycles and never blocks. */
+static inline uint64_t
+clock_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* The same clock in nanoseconds, once timer_calibrate() has
+   measured the cycle rate. */
+uint64_t clock_hz (void);
+uint64_t clock_ns (void);
+uint64_t clock_cycles_to_ns (uint64_t cycles);
+
 #endif /* devices/timer.h */
@@ -9,6 +9,8 @@ int
 main (int argc, char *argv[]) 
 {
   int in_fd, out_fd;
+  int bytes_read;
+  unsigned ofs;
 
   if (argc != 3) 
     {
@@ -37,14 +39,14 @@ main (int argc, char *argv[])
       return EXIT_FAILURE;
     }
 
-  /* Copy data. */
-  for (;;) 
+  /* Copy data, giving the offset with each call. */
+  for (ofs = 0; ; ofs += bytes_read) 
     {
       char buffer[1024];
-      int bytes_read = read (in_fd, buffer, sizeof buffer);
-      if (bytes_read == 0)
+      bytes_read = pread (in_fd, buffer, sizeof buffer, ofs);
+      if (bytes_read <= 0)
         break;
-      if (write (out_fd, buffer, bytes_read) != bytes_read) 
+      if (pwrite (out_fd, buffer, bytes_read, ofs) != bytes_read) 
         {
           printf ("%s: write failed\n", argv[2]);
           return EXIT_FAILURE;
@@ -0,0 +1,118 @@
+/* top.c
+
+   Prints the resource usage of every thread, like Unix top, a
+   few times over.
+
+   Usage: top [ROUNDS [INTERVAL-MS]]
+
+   There is no system call to sleep, so top waits between rounds
+   by spinning on the clock, and so shows up as the busiest
+   process itself. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+/* Most threads shown. */
+#define MAX_THREADS 32
+
+static struct procstat prev[MAX_THREADS], cur[MAX_THREADS];
+static int prev_cnt, cur_cnt;
+
+/* Returns the entry for thread TID in PREV, or a null pointer. */
+static const struct procstat *
+find_prev (int tid)
+{
+  int i;
+
+  for (i = 0; i < prev_cnt; i++)
+    if (prev[i].tid == tid)
+      return &prev[i];
+  return NULL;
+}
+
+/* Returns the total number of system calls counted in PS. */
+static unsigned
+syscall_total (const struct procstat *ps)
+{
+  unsigned total = 0;
+  int i;
+
+  for (i = 0; i < PROCSTAT_SYSCALL_CNT; i++)
+    total += ps->syscalls[i];
+  return total;
+}
+
+/* Prints one round.  %CPU is the share of the ELAPSED_NS since
+   the previous round, or since boot in the first one. */
+static void
+print_round (uint64_t elapsed_ns)
+{
+  int i;
+
+  printf ("%5s %-14s %3s %5s %9s %9s %6s %6s %5s %5s %8s %8s %6s %7s\n",
+          "TID", "NAME", "PRI", "%CPU", "USER-ms", "SYS-ms", "MINFLT",
+          "MAJFLT", "SWIN", "SWOUT", "READ-kB", "WRITE-kB", "FRAMES",
+          "SYSCALL");
+  for (i = 0; i < cur_cnt; i++)
+    {
+      const struct procstat *ps = &cur[i];
+      const struct procstat *old = find_prev (ps->tid);
+      uint64_t cpu_ns = ps->user_ns + ps->kernel_ns;
+      unsigned permille;
+
+      if (old != NULL)
+        cpu_ns -= old->user_ns + old->kernel_ns;
+      permille = elapsed_ns > 0 ? cpu_ns * 1000 / elapsed_ns : 0;
+
+      printf ("%5d %-14s %3d %3u.%u %9"PRIu64" %9"PRIu64" %6"PRIu32
+              " %6"PRIu32" %5"PRIu32" %5"PRIu32" %8"PRIu64" %8"PRIu64
+              " %6"PRIu32" %7u\n",
+              ps->tid, ps->name, ps->priority, permille / 10, permille % 10,
+              ps->user_ns / 1000000, ps->kernel_ns / 1000000,
+              ps->minor_faults, ps->major_faults, ps->swap_ins,
+              ps->swap_outs, ps->bytes_read / 1024, ps->bytes_written / 1024,
+              ps->frames, syscall_total (ps));
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  int rounds = argc > 1 ? atoi (argv[1]) : 3;
+  int interval_ms = argc > 2 ? atoi (argv[2]) : 1000;
+  uint64_t last = 0;
+  int round;
+
+  for (round = 0; round < rounds; round++)
+    {
+      uint64_t now;
+      int cnt;
+
+      if (round > 0)
+        {
+          uint64_t until = last + (uint64_t) interval_ms * 1000000;
+          while (clock_ns () < until)
+            continue;
+        }
+
+      cnt = stats_all (cur, MAX_THREADS);
+      if (cnt < 0)
+        {
+          printf ("top: stats_all failed\n");
+          return EXIT_FAILURE;
+        }
+      cur_cnt = cnt < MAX_THREADS ? cnt : MAX_THREADS;
+      now = clock_ns ();
+
+      printf ("top: round %d, %d threads\n", round + 1, cnt);
+      print_round (now - last);
+      printf ("\n");
+
+      for (prev_cnt = 0; prev_cnt < cur_cnt; prev_cnt++)
+        prev[prev_cnt] = cur[prev_cnt];
+      last = now;
+    }
+  return EXIT_SUCCESS;
+}
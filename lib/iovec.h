@@ -0,0 +1,16 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* Most buffers one readv() or writev() system call takes. */
+#define IOV_MAX 16
+
+/* One buffer of a readv() or writev() system call. */
+struct iovec
+  {
+    void *iov_base;             /* Start of the buffer. */
+    size_t iov_len;             /* Size of the buffer in bytes. */
+  };
+
+#endif /* lib/iovec.h */
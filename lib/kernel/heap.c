@@ -0,0 +1,211 @@
+/* Pairing heap.
+
+   See heap.h for basic information. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+
+/* Initializes heap H as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->size = 0;
+  h->next_seq = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into heap H. */
+void
+heap_push (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  e->seq = h->next_seq++;
+  h->root = meld (h, h->root, e);
+  h->size++;
+}
+
+/* Removes the greatest element from heap H and returns it.
+   H must not be empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *top;
+
+  ASSERT (!heap_empty (h));
+
+  top = h->root;
+  h->root = merge_pairs (h, top->child);
+  if (h->root != NULL)
+    h->root->prev = NULL;
+  h->size--;
+  return top;
+}
+
+/* Removes E, which must be in heap H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  struct heap_elem *sub;
+
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+  ASSERT (h->size > 0);
+
+  if (e == h->root)
+    {
+      heap_pop (h);
+      return;
+    }
+  cut (e);
+  sub = merge_pairs (h, e->child);
+  if (sub != NULL)
+    h->root = meld (h, h->root, sub);
+  h->size--;
+}
+
+/* Restores the heap order of H after the key of E, which must
+   be in H, has changed.  E keeps its place among elements that
+   compare equal to it. */
+void
+heap_update (struct heap *h, struct heap_elem *e)
+{
+  unsigned seq = e->seq;
+
+  heap_remove (h, e);
+  e->child = e->next = e->prev = NULL;
+  e->seq = seq;
+  h->root = meld (h, h->root, e);
+  h->size++;
+}
+
+/* Returns the greatest element in heap H, which must not be
+   empty. */
+struct heap_elem *
+heap_top (struct heap *h)
+{
+  ASSERT (!heap_empty (h));
+  return h->root;
+}
+
+/* Returns the number of elements in heap H. */
+size_t
+heap_size (struct heap *h)
+{
+  ASSERT (h != NULL);
+  return h->size;
+}
+
+/* Returns true if heap H is empty, false otherwise. */
+bool
+heap_empty (struct heap *h)
+{
+  ASSERT (h != NULL);
+  return h->root == NULL;
+}
+
+/* Returns true if A goes below B in heap H: A is less than B,
+   or they are equal and B was pushed first. */
+static inline bool
+below (struct heap *h, const struct heap_elem *a, const struct heap_elem *b)
+{
+  if (h->less (a, b, h->aux))
+    return true;
+  if (h->less (b, a, h->aux))
+    return false;
+  return (int) (b->seq - a->seq) < 0;
+}
+
+/* Links heaps A and B, either of which may be empty, and returns
+   the root of the result.  A and B must not have siblings. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (below (h, a, b))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* B becomes the leftmost child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  a->next = a->prev = NULL;
+  return a;
+}
+
+/* Combines the sibling list starting at FIRST into one heap and
+   returns its root.  Pairs are melded left to right, then the
+   results right to left.  Iterative, so a long sibling list does
+   not use up the kernel stack. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *result;
+
+  /* First pass: meld adjacent pairs, chaining the results
+     through `next' in reverse order. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+      struct heap_elem *m;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        b->next = b->prev = NULL;
+      m = meld (h, a, b);
+      m->next = pairs;
+      pairs = m;
+    }
+
+  /* Second pass: meld the results from right to left. */
+  result = NULL;
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->next;
+      pairs->next = NULL;
+      result = meld (h, result, pairs);
+      pairs = next;
+    }
+  return result;
+}
+
+/* Detaches the subtree rooted at E, which must not be the root
+   of its heap, from its parent and siblings. */
+static void
+cut (struct heap_elem *e)
+{
+  ASSERT (e->prev != NULL);
+
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+}
@@ -0,0 +1,29 @@
+#ifndef __LIB_PROCSTAT_H
+#define __LIB_PROCSTAT_H
+
+#include <stdint.h>
+
+/* System calls counted separately, by number.  Calls numbered
+   higher are not counted. */
+#define PROCSTAT_SYSCALL_CNT 32
+
+/* Resource usage of one thread, as returned by the stats() and
+   stats_all() system calls.  A user process is one thread. */
+struct procstat
+  {
+    int tid;                            /* Thread identifier. */
+    char name[16];                      /* Thread name. */
+    int priority;                       /* Current priority. */
+    uint64_t user_ns;                   /* CPU time in user mode. */
+    uint64_t kernel_ns;                 /* CPU time in the kernel. */
+    uint32_t minor_faults;              /* Page faults handled without I/O. */
+    uint32_t major_faults;              /* Page loads that read a file or swap. */
+    uint32_t swap_ins;                  /* Pages read back from swap. */
+    uint32_t swap_outs;                 /* Pages written out to swap. */
+    uint64_t bytes_read;                /* Bytes returned by read(). */
+    uint64_t bytes_written;             /* Bytes accepted by write(). */
+    uint32_t frames;                    /* Resident frames. */
+    uint32_t syscalls[PROCSTAT_SYSCALL_CNT]; /* System calls by number. */
+  };
+
+#endif /* lib/procstat.h */
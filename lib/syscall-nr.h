@@ -28,7 +28,21 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Timing and accounting. */
+    SYS_CLOCK,                  /* Reads the high-resolution clock. */
+    SYS_STATS,                  /* Resource usage of a process. */
+    SYS_STATS_ALL,              /* Resource usage of every thread. */
+
+    /* Scheduling. */
+    SYS_SCHED_DEADLINE,         /* Reserve CPU time by a deadline. */
+
+    /* Positional and vectored I/O. */
+    SYS_PREAD,                  /* Read from a file at an offset. */
+    SYS_PWRITE,                 /* Write to a file at an offset. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV                  /* Write to a file from several buffers. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -3,8 +3,25 @@
 int main (int, char *[]);
 void _start (int argc, char *argv[]);
 
+/* In syscall.c. */
+extern int syscall_sysenter;
+
+/* Returns true if the CPU has the sysenter and sysexit
+   instructions.  The kernel makes the same check to decide
+   whether to set them up. */
+static bool
+cpu_has_sysenter (void) 
+{
+  unsigned eax, ebx, ecx, edx;
+
+  asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                : "a" (1));
+  return (edx & (1 << 11)) != 0;
+}
+
 void
 _start (int argc, char *argv[]) 
 {
+  syscall_sysenter = cpu_has_sysenter ();
   exit (main (argc, argv));
 }
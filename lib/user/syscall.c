@@ -1,16 +1,31 @@
 #include <syscall.h>
 #include "../syscall-nr.h"
 
+/* Nonzero if the CPU has sysenter, in which case system calls
+   use it instead of int $0x30.  Set by _start(). */
+int syscall_sysenter;
+
+/* Enters the kernel with the system call number and arguments
+   already pushed.  sysenter takes the stack pointer in %ecx and
+   the address to come back to in %edx, and sysexit returns
+   there, skipping the int $0x30 that is used without it. */
+#define SYSCALL_ENTER                                   \
+        "cmpl $0, %[fast]; je 2f; "                     \
+        "movl %%esp, %%ecx; movl $1f, %%edx; sysenter; " \
+        "2: int $0x30; 1: "
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; " SYSCALL_ENTER                  \
+             "addl $4, %%esp"                                   \
                : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : [number] "i" (NUMBER),                         \
+                 [fast] "m" (syscall_sysenter)                  \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
@@ -20,11 +35,13 @@
         ({                                                               \
           int retval;                                                    \
           asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
+            ("pushl %[arg0]; pushl %[number]; " SYSCALL_ENTER            \
+             "addl $8, %%esp"                                            \
                : "=a" (retval)                                           \
                : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
+                 [arg0] "g" (ARG0),                                      \
+                 [fast] "m" (syscall_sysenter)                           \
+               : "ecx", "edx", "cc", "memory");                          \
           retval;                                                        \
         })
 
@@ -35,12 +52,14 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_ENTER                  \
+             "addl $12, %%esp"                                  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
-                 [arg1] "r" (ARG1)                              \
-               : "memory");                                     \
+                 [arg1] "r" (ARG1),                             \
+                 [fast] "m" (syscall_sysenter)                  \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
@@ -51,13 +70,36 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_ENTER                  \
+             "addl $16, %%esp"                                  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
                  [arg1] "r" (ARG1),                             \
-                 [arg2] "r" (ARG2)                              \
-               : "memory");                                     \
+                 [arg2] "r" (ARG2),                             \
+                 [fast] "m" (syscall_sysenter)                  \
+               : "ecx", "edx", "cc", "memory");                 \
+          retval;                                               \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'.  ARG3 is
+   pushed first, so it may be a stack operand. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; " SYSCALL_ENTER   \
+             "addl $20, %%esp"                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "r" (ARG0),                             \
+                 [arg1] "r" (ARG1),                             \
+                 [arg2] "r" (ARG2),                             \
+                 [arg3] "g" (ARG3),                             \
+                 [fast] "m" (syscall_sysenter)                  \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
@@ -182,3 +224,54 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+uint64_t
+clock_ns (void) 
+{
+  uint64_t ns;
+  syscall1 (SYS_CLOCK, &ns);
+  return ns;
+}
+
+bool
+stats (pid_t pid, struct procstat *ps) 
+{
+  return syscall2 (SYS_STATS, pid, ps);
+}
+
+int
+stats_all (struct procstat *ps, int max) 
+{
+  return syscall2 (SYS_STATS_ALL, ps, max);
+}
+
+bool
+sched_deadline (unsigned runtime_ms, unsigned deadline_ms,
+                unsigned period_ms) 
+{
+  return syscall3 (SYS_SCHED_DEADLINE, runtime_ms, deadline_ms, period_ms);
+}
+
+int
+pread (int fd, void *buffer, unsigned length, unsigned offset) 
+{
+  return syscall4 (SYS_PREAD, fd, buffer, length, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned length, unsigned offset) 
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, length, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt) 
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) 
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
@@ -2,6 +2,9 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <iovec.h>
+#include <procstat.h>
 #include <debug.h>
 
 /* Process identifier. */
@@ -45,4 +48,19 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Timing and accounting. */
+uint64_t clock_ns (void);
+bool stats (pid_t, struct procstat *);
+int stats_all (struct procstat *, int max);
+
+/* Scheduling. */
+bool sched_deadline (unsigned runtime_ms, unsigned deadline_ms,
+                     unsigned period_ms);
+
+/* Positional and vectored I/O. */
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,23 @@
+/* Helpers shared by the user benchmarks. */
+
+#include "tests/bench/bench.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+/* Prints a result as a `BENCH NAME VALUE UNIT' line, the format
+   utils/pintos-bench collects. */
+void
+bench_report (const char *name, uint64_t value, const char *unit)
+{
+  printf ("BENCH %s %"PRIu64" %s\n", name, value, unit);
+}
+
+/* Returns the throughput of BYTES moved in NS nanoseconds, in
+   kB/s. */
+uint64_t
+bench_kbps (uint64_t bytes, uint64_t ns)
+{
+  if (ns == 0)
+    return 0;
+  return bytes * 1000000000 / 1024 / ns;
+}
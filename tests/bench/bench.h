@@ -0,0 +1,9 @@
+#ifndef TESTS_BENCH_BENCH_H
+#define TESTS_BENCH_BENCH_H
+
+#include <stdint.h>
+
+void bench_report (const char *name, uint64_t value, const char *unit);
+uint64_t bench_kbps (uint64_t bytes, uint64_t ns);
+
+#endif /* tests/bench/bench.h */
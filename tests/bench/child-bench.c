@@ -0,0 +1,8 @@
+/* Child process run by the exec-wait benchmark.  Does nothing,
+   so that only process startup and teardown are measured. */
+
+int
+main (void) 
+{
+  return 0;
+}
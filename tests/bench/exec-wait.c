@@ -0,0 +1,27 @@
+/* Measures starting a child process and waiting for it to
+   exit. */
+
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITERATIONS 20
+
+void
+test_main (void) 
+{
+  uint64_t start;
+  int i;
+
+  start = clock_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      pid_t pid = exec ("child-bench");
+      if (pid == PID_ERROR)
+        fail ("exec \"child-bench\" failed");
+      if (wait (pid) != 0)
+        fail ("child-bench did not exit with 0");
+    }
+  bench_report ("exec-wait", (clock_ns () - start) / ITERATIONS / 1000, "us");
+}
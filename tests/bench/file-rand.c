@@ -0,0 +1,50 @@
+/* Measures reads and writes of single sectors at random offsets
+   in a file created at its full size. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (128 * 1024)
+#define BLOCK_SIZE 512
+#define ITERATIONS 500
+
+static char buf[BLOCK_SIZE];
+
+/* Moves FD to a random block. */
+static void
+seek_random (int fd)
+{
+  seek (fd, random_ulong () % (FILE_SIZE / BLOCK_SIZE) * BLOCK_SIZE);
+}
+
+void
+test_main (void) 
+{
+  uint64_t start;
+  int fd, i;
+
+  CHECK (create ("bench", FILE_SIZE), "create \"bench\"");
+  CHECK ((fd = open ("bench")) > 1, "open \"bench\"");
+
+  start = clock_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      seek_random (fd);
+      if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write %d failed", i);
+    }
+  bench_report ("file-rand-write", (clock_ns () - start) / ITERATIONS, "ns");
+
+  start = clock_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      seek_random (fd);
+      if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read %d failed", i);
+    }
+  bench_report ("file-rand-read", (clock_ns () - start) / ITERATIONS, "ns");
+  close (fd);
+}
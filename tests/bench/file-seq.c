@@ -0,0 +1,47 @@
+/* Measures sequential write and read throughput, a block at a
+   time, over a file created at its full size. */
+
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (128 * 1024)
+#define BLOCK_SIZE 4096
+#define PASSES 4
+
+static char buf[BLOCK_SIZE];
+
+void
+test_main (void) 
+{
+  uint64_t start, write_ns = 0, read_ns = 0;
+  int fd, pass;
+  size_t ofs;
+
+  CHECK (create ("bench", FILE_SIZE), "create \"bench\"");
+  CHECK ((fd = open ("bench")) > 1, "open \"bench\"");
+
+  for (pass = 0; pass < PASSES; pass++)
+    {
+      seek (fd, 0);
+      start = clock_ns ();
+      for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+        if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+          fail ("write at offset %zu failed", ofs);
+      write_ns += clock_ns () - start;
+
+      seek (fd, 0);
+      start = clock_ns ();
+      for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+        if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+          fail ("read at offset %zu failed", ofs);
+      read_ns += clock_ns () - start;
+    }
+  close (fd);
+
+  bench_report ("file-seq-write",
+                bench_kbps ((uint64_t) FILE_SIZE * PASSES, write_ns), "kB/s");
+  bench_report ("file-seq-read",
+                bench_kbps ((uint64_t) FILE_SIZE * PASSES, read_ns), "kB/s");
+}
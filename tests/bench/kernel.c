@@ -0,0 +1,165 @@
+/* Kernel benchmarks, run from the kernel command line like the
+   tests in tests/threads, e.g. `run ctxsw'. */
+
+#include "tests/bench/kernel.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Blocks allocated before freeing them all again, so that the
+   allocators do more than hand the same block back and forth. */
+#define BATCH 64
+
+static void bench_ctxsw (void);
+static void bench_malloc (void);
+static void bench_palloc (void);
+
+struct bench
+  {
+    const char *name;
+    void (*function) (void);
+  };
+
+static const struct bench benches[] =
+  {
+    {"ctxsw", bench_ctxsw},
+    {"malloc", bench_malloc},
+    {"palloc", bench_palloc},
+  };
+
+/* Prints a result as a `BENCH NAME VALUE UNIT' line, the format
+   utils/pintos-bench collects. */
+static void
+report (const char *name, uint64_t value, const char *unit)
+{
+  printf ("BENCH %s %"PRIu64" %s\n", name, value, unit);
+}
+
+/* Runs the benchmark named NAME and returns true, or returns
+   false if there is no such benchmark. */
+bool
+run_bench (const char *name)
+{
+  const struct bench *b;
+
+  for (b = benches; b < benches + sizeof benches / sizeof *benches; b++)
+    if (!strcmp (name, b->name))
+      {
+        b->function ();
+        return true;
+      }
+  return false;
+}
+
+/* Context switches: two threads of equal priority pass control
+   back and forth through a pair of semaphores. */
+
+#define CTXSW_ROUNDS 10000
+
+static struct semaphore ping, pong;
+
+static void
+ctxsw_partner (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < CTXSW_ROUNDS; i++)
+    {
+      sema_down (&ping);
+      sema_up (&pong);
+    }
+}
+
+static void
+bench_ctxsw (void)
+{
+  uint64_t start;
+  int i;
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  thread_create ("ctxsw", thread_get_priority (), ctxsw_partner, NULL);
+
+  start = clock_ns ();
+  for (i = 0; i < CTXSW_ROUNDS; i++)
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+    }
+
+  /* Each round switches twice. */
+  report ("ctxsw", (clock_ns () - start) / (2 * CTXSW_ROUNDS), "ns");
+}
+
+/* malloc() and free() pairs, for block sizes served from an
+   arena and for a size that takes whole pages. */
+
+#define MALLOC_ROUNDS 200
+
+static void
+bench_malloc_size (size_t size)
+{
+  static void *blocks[BATCH];
+  char name[32];
+  uint64_t start;
+  int round, i;
+
+  start = clock_ns ();
+  for (round = 0; round < MALLOC_ROUNDS; round++)
+    {
+      for (i = 0; i < BATCH; i++)
+        if ((blocks[i] = malloc (size)) == NULL)
+          PANIC ("malloc (%zu) failed", size);
+      for (i = 0; i < BATCH; i++)
+        free (blocks[i]);
+    }
+
+  snprintf (name, sizeof name, "malloc-%zu", size);
+  report (name, (clock_ns () - start) / (MALLOC_ROUNDS * BATCH), "ns");
+}
+
+static void
+bench_malloc (void)
+{
+  bench_malloc_size (16);
+  bench_malloc_size (256);
+  bench_malloc_size (1024);
+  bench_malloc_size (4096);
+}
+
+/* palloc_get_page() and palloc_free_page() pairs, with and
+   without zeroing. */
+
+#define PALLOC_ROUNDS 100
+
+static void
+bench_palloc_flags (const char *name, enum palloc_flags flags)
+{
+  static void *pages[BATCH];
+  uint64_t start;
+  int round, i;
+
+  start = clock_ns ();
+  for (round = 0; round < PALLOC_ROUNDS; round++)
+    {
+      for (i = 0; i < BATCH; i++)
+        if ((pages[i] = palloc_get_page (flags)) == NULL)
+          PANIC ("palloc_get_page failed");
+      for (i = 0; i < BATCH; i++)
+        palloc_free_page (pages[i]);
+    }
+  report (name, (clock_ns () - start) / (PALLOC_ROUNDS * BATCH), "ns");
+}
+
+static void
+bench_palloc (void)
+{
+  bench_palloc_flags ("palloc", 0);
+  bench_palloc_flags ("palloc-zero", PAL_ZERO);
+}
@@ -0,0 +1,8 @@
+#ifndef TESTS_BENCH_KERNEL_H
+#define TESTS_BENCH_KERNEL_H
+
+#include <stdbool.h>
+
+bool run_bench (const char *name);
+
+#endif /* tests/bench/kernel.h */
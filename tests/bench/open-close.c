@@ -0,0 +1,27 @@
+/* Measures opening and closing an existing file. */
+
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITERATIONS 1000
+
+void
+test_main (void) 
+{
+  uint64_t start;
+  int i;
+
+  CHECK (create ("bench", 0), "create \"bench\"");
+
+  start = clock_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      int fd = open ("bench");
+      if (fd < 2)
+        fail ("open \"bench\" returned %d", fd);
+      close (fd);
+    }
+  bench_report ("open-close", (clock_ns () - start) / ITERATIONS, "ns");
+}
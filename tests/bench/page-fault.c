@@ -0,0 +1,44 @@
+/* Measures page faults: first touches of zero-filled pages, and
+   touches of pages that were swapped out.
+
+   The buffer is larger than user memory.  The first part is
+   touched first, while memory is free, then the rest pushes it
+   out to swap, and then it is touched again. */
+
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SIZE (2 * 1024 * 1024)
+#define MEASURED (256 * 1024)
+
+static char buf[SIZE];
+
+/* Writes to each page of buf in [START, END) and returns the
+   time it took. */
+static uint64_t
+touch (size_t start, size_t end)
+{
+  uint64_t t = clock_ns ();
+  size_t ofs;
+
+  for (ofs = start; ofs < end; ofs += PAGE_SIZE)
+    buf[ofs] = 1;
+  return clock_ns () - t;
+}
+
+void
+test_main (void) 
+{
+  uint64_t ns;
+
+  ns = touch (0, MEASURED);
+  bench_report ("page-fault-first-touch", ns / (MEASURED / PAGE_SIZE), "ns");
+
+  touch (MEASURED, SIZE);
+
+  ns = touch (0, MEASURED);
+  bench_report ("page-fault-swap-in", ns / (MEASURED / PAGE_SIZE), "ns");
+}
@@ -0,0 +1,89 @@
+/* Measures the round trip into the kernel and back with the
+   cheapest system calls there are: closing a file descriptor
+   that is not open, and reading the clock.  The null system
+   call is also timed through int $0x30 and through sysenter
+   explicitly, whichever the C library picks, and in cycles as
+   well as nanoseconds, so the two entry paths can be compared
+   directly. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITERATIONS 10000
+
+/* Set by _start() if the CPU has sysenter. */
+extern int syscall_sysenter;
+
+/* Reads the time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* close (FD) through int $0x30. */
+static void
+close_int (int fd)
+{
+  asm volatile ("pushl %[fd]; pushl %[number]; int $0x30; addl $8, %%esp"
+                : : [number] "i" (SYS_CLOSE), [fd] "r" (fd)
+                : "eax", "memory");
+}
+
+/* close (FD) through sysenter. */
+static void
+close_sysenter (int fd)
+{
+  asm volatile ("pushl %[fd]; pushl %[number]; "
+                "movl %%esp, %%ecx; movl $1f, %%edx; sysenter; 1: "
+                "addl $8, %%esp"
+                : : [number] "i" (SYS_CLOSE), [fd] "r" (fd)
+                : "eax", "ecx", "edx", "cc", "memory");
+}
+
+/* Reports the latency of a null system call made by ENTER as
+   NAME, in nanoseconds, and as NAME-cycles, in cycles. */
+static void
+time_entry (const char *name, void (*enter) (int))
+{
+  char cycles_name[64];
+  uint64_t start, tsc;
+  int i;
+
+  start = clock_ns ();
+  tsc = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    enter (-1);
+  tsc = rdtsc () - tsc;
+  bench_report (name, (clock_ns () - start) / ITERATIONS, "ns");
+
+  snprintf (cycles_name, sizeof cycles_name, "%s-cycles", name);
+  bench_report (cycles_name, tsc / ITERATIONS, "cycles");
+}
+
+void
+test_main (void)
+{
+  uint64_t start;
+  int i;
+
+  start = clock_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    close (-1);
+  bench_report ("syscall-null", (clock_ns () - start) / ITERATIONS, "ns");
+
+  time_entry ("syscall-null-int", close_int);
+  if (syscall_sysenter)
+    time_entry ("syscall-null-sysenter", close_sysenter);
+
+  start = clock_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    clock_ns ();
+  bench_report ("syscall-clock", (clock_ns () - start) / ITERATIONS, "ns");
+}
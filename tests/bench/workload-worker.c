@@ -0,0 +1,190 @@
+/* Worker process of the workload benchmark.
+
+   Usage: workload-worker ID MS WSS-KB FILE MEM MMAP SPAWN
+
+   Runs operations for MS milliseconds, picking each one at random
+   with the FILE:MEM:MMAP:SPAWN ratio, and timing it.  Anonymous
+   memory operations touch a working set of WSS-KB kB.  The counts
+   and latency histograms are written to the file "wl-out-ID" for
+   the driver. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/bench/workload.h"
+#include "tests/lib.h"
+
+const char *test_name = "workload-worker";
+
+#define PAGE_SIZE 4096
+
+/* Largest working set of anonymous memory. */
+#define MAX_WSS (4 * 1024 * 1024)
+
+/* Pages touched by one memory operation. */
+#define TOUCHES_PER_OP 8
+
+/* Size of the files written by file operations. */
+#define FILE_SIZE (8 * 1024)
+
+/* Size of the file scanned by mmap operations, and where it is
+   mapped. */
+#define MAP_SIZE (32 * 1024)
+#define MAP_ADDR ((void *) 0x10000000)
+
+static char wss[MAX_WSS];
+static char buf[FILE_SIZE];
+static struct workload_result result;
+
+static int id;
+static size_t wss_pages;
+static char file_name[16], map_name[16];
+
+/* Creates a file, writes it, reads it back and removes it. */
+static void
+do_file (void)
+{
+  int fd;
+
+  if (!create (file_name, 0))
+    fail ("create \"%s\" failed", file_name);
+  if ((fd = open (file_name)) < 2)
+    fail ("open \"%s\" failed", file_name);
+  if (write (fd, buf, FILE_SIZE) != FILE_SIZE)
+    fail ("write \"%s\" failed", file_name);
+  seek (fd, 0);
+  if (read (fd, buf, FILE_SIZE) != FILE_SIZE)
+    fail ("read \"%s\" failed", file_name);
+  close (fd);
+  if (!remove (file_name))
+    fail ("remove \"%s\" failed", file_name);
+}
+
+/* Writes to random pages of the working set. */
+static void
+do_mem (void)
+{
+  int i;
+
+  for (i = 0; i < TOUCHES_PER_OP; i++)
+    wss[random_ulong () % wss_pages * PAGE_SIZE]++;
+}
+
+/* Maps the map file and reads a byte of each page. */
+static void
+do_mmap (void)
+{
+  volatile const char *p = MAP_ADDR;
+  mapid_t map;
+  size_t ofs;
+  int fd;
+
+  if ((fd = open (map_name)) < 2)
+    fail ("open \"%s\" failed", map_name);
+  if ((map = mmap (fd, MAP_ADDR)) == MAP_FAILED)
+    fail ("mmap \"%s\" failed", map_name);
+  for (ofs = 0; ofs < MAP_SIZE; ofs += PAGE_SIZE)
+    if (p[ofs] != (char) id)
+      fail ("\"%s\" has wrong contents", map_name);
+  munmap (map);
+  close (fd);
+}
+
+/* Runs child-bench and waits for it. */
+static void
+do_spawn (void)
+{
+  pid_t pid = exec ("child-bench");
+
+  if (pid == PID_ERROR)
+    fail ("exec \"child-bench\" failed");
+  if (wait (pid) != 0)
+    fail ("child-bench did not exit with 0");
+}
+
+/* Creates the file that mmap operations scan. */
+static void
+make_map_file (void)
+{
+  static char page[PAGE_SIZE];
+  size_t ofs;
+  int fd;
+
+  memset (page, id, sizeof page);
+  if (!create (map_name, MAP_SIZE) || (fd = open (map_name)) < 2)
+    fail ("create \"%s\" failed", map_name);
+  for (ofs = 0; ofs < MAP_SIZE; ofs += PAGE_SIZE)
+    if (write (fd, page, PAGE_SIZE) != PAGE_SIZE)
+      fail ("write \"%s\" failed", map_name);
+  close (fd);
+}
+
+/* Writes the results for the driver. */
+static void
+write_result (void)
+{
+  char name[16];
+  int fd;
+
+  snprintf (name, sizeof name, "wl-out-%d", id);
+  if (!create (name, sizeof result) || (fd = open (name)) < 2)
+    fail ("create \"%s\" failed", name);
+  if (write (fd, &result, sizeof result) != (int) sizeof result)
+    fail ("write \"%s\" failed", name);
+  close (fd);
+}
+
+int
+main (int argc, char *argv[])
+{
+  static void (*const ops[WL_OP_CNT]) (void) =
+    {do_file, do_mem, do_mmap, do_spawn};
+  int ratio[WL_OP_CNT];
+  int ratio_sum = 0;
+  uint64_t end;
+  size_t wss_kb;
+  int i;
+
+  if (argc != 4 + WL_OP_CNT)
+    fail ("usage: workload-worker ID MS WSS-KB FILE MEM MMAP SPAWN");
+  id = atoi (argv[1]);
+  end = clock_ns () + (uint64_t) atoi (argv[2]) * 1000000;
+  wss_kb = atoi (argv[3]);
+  for (i = 0; i < WL_OP_CNT; i++)
+    ratio_sum += ratio[i] = atoi (argv[4 + i]);
+  if (ratio_sum <= 0)
+    fail ("no operations to run");
+
+  wss_pages = wss_kb * 1024 / PAGE_SIZE;
+  if (wss_pages < 1)
+    wss_pages = 1;
+  if (wss_pages > MAX_WSS / PAGE_SIZE)
+    wss_pages = MAX_WSS / PAGE_SIZE;
+  snprintf (file_name, sizeof file_name, "wl-file-%d", id);
+  snprintf (map_name, sizeof map_name, "wl-map-%d", id);
+  if (ratio[WL_MMAP] > 0)
+    make_map_file ();
+  random_init (id + 1);
+
+  while (clock_ns () < end)
+    {
+      int pick = random_ulong () % ratio_sum;
+      uint64_t start;
+      int op;
+
+      for (op = 0; pick >= ratio[op]; op++)
+        pick -= ratio[op];
+
+      start = clock_ns ();
+      ops[op] ();
+      result.hist[op][workload_bucket (clock_ns () - start)]++;
+      result.ops[op]++;
+    }
+
+  if (ratio[WL_MMAP] > 0)
+    remove (map_name);
+  write_result ();
+  return 0;
+}
@@ -0,0 +1,165 @@
+/* Mixed workload: worker processes that together load the file
+   system, the VM and process creation, to reproduce contention
+   on the kernel's global locks.
+
+   Usage: workload [-w WORKERS] [-t MS] [-m WSS-KB]
+                   [-r FILE:MEM:MMAP:SPAWN]
+
+   Starts WORKERS workload-worker processes (default 4), which
+   run for MS milliseconds (default 1000).  Each operation is
+   picked at random with the given ratio (default 1:4:1:1):
+
+     FILE   creates an 8 kB file, writes it, reads it back and
+            removes it.
+     MEM    writes to 8 random pages of a WSS-KB kB anonymous
+            working set (default 1024, at most 4096).
+     MMAP   maps a 32 kB file and reads every page.
+     SPAWN  execs child-bench and waits for it.
+
+   Reports the throughput of each kind of operation, and of all
+   of them, and the 50th, 90th and 99th percentile latencies. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/bench/workload.h"
+#include "tests/lib.h"
+
+const char *test_name = "workload";
+
+/* Most worker processes. */
+#define MAX_WORKERS 16
+
+static const char *op_names[WL_OP_CNT] = {"file", "mem", "mmap", "spawn"};
+
+static struct workload_result total, part;
+
+/* Reads the results of worker ID, adds them to TOTAL and removes
+   the file. */
+static void
+read_result (int id)
+{
+  char name[32];
+  int fd, op, b;
+
+  snprintf (name, sizeof name, "wl-out-%d", id);
+  if ((fd = open (name)) < 2)
+    fail ("open \"%s\" failed", name);
+  if (read (fd, &part, sizeof part) != (int) sizeof part)
+    fail ("read \"%s\" failed", name);
+  close (fd);
+  remove (name);
+
+  for (op = 0; op < WL_OP_CNT; op++)
+    {
+      total.ops[op] += part.ops[op];
+      for (b = 0; b < WL_BUCKETS; b++)
+        total.hist[op][b] += part.hist[op][b];
+    }
+}
+
+/* Returns the latency that PERCENT percent of the OP operations
+   took at most. */
+static uint64_t
+percentile (int op, int percent)
+{
+  uint64_t want = ((uint64_t) total.ops[op] * percent + 99) / 100;
+  uint64_t seen = 0;
+  int b;
+
+  for (b = 0; b < WL_BUCKETS; b++)
+    {
+      seen += total.hist[op][b];
+      if (seen >= want)
+        break;
+    }
+  return workload_bucket_max (b < WL_BUCKETS ? b : WL_BUCKETS - 1);
+}
+
+/* Parses RATIO, as FILE:MEM:MMAP:SPAWN, into RATIOS[]. */
+static void
+parse_ratio (char *ratio, int ratios[WL_OP_CNT])
+{
+  char *token, *save_ptr;
+  int op = 0;
+
+  for (token = strtok_r (ratio, ":", &save_ptr); token != NULL;
+       token = strtok_r (NULL, ":", &save_ptr))
+    {
+      if (op >= WL_OP_CNT)
+        fail ("too many ratios in -r");
+      ratios[op++] = atoi (token);
+    }
+  if (op != WL_OP_CNT)
+    fail ("-r needs FILE:MEM:MMAP:SPAWN");
+}
+
+int
+main (int argc, char *argv[])
+{
+  int workers = 4, ms = 1000, wss_kb = 1024;
+  int ratios[WL_OP_CNT] = {1, 4, 1, 1};
+  pid_t pids[MAX_WORKERS];
+  uint64_t start, elapsed, all_ops;
+  char name[64];
+  int i, op;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (i + 1 >= argc)
+        fail ("option %s needs a value", argv[i]);
+      if (!strcmp (argv[i], "-w"))
+        workers = atoi (argv[++i]);
+      else if (!strcmp (argv[i], "-t"))
+        ms = atoi (argv[++i]);
+      else if (!strcmp (argv[i], "-m"))
+        wss_kb = atoi (argv[++i]);
+      else if (!strcmp (argv[i], "-r"))
+        parse_ratio (argv[++i], ratios);
+      else
+        fail ("usage: workload [-w WORKERS] [-t MS] [-m WSS-KB] "
+              "[-r FILE:MEM:MMAP:SPAWN]");
+    }
+  if (workers < 1 || workers > MAX_WORKERS)
+    fail ("WORKERS must be between 1 and %d", MAX_WORKERS);
+
+  start = clock_ns ();
+  for (i = 0; i < workers; i++)
+    {
+      char cmd[128];
+
+      snprintf (cmd, sizeof cmd, "workload-worker %d %d %d %d %d %d %d",
+                i, ms, wss_kb, ratios[WL_FILE], ratios[WL_MEM],
+                ratios[WL_MMAP], ratios[WL_SPAWN]);
+      if ((pids[i] = exec (cmd)) == PID_ERROR)
+        fail ("exec \"%s\" failed", cmd);
+    }
+  for (i = 0; i < workers; i++)
+    if (wait (pids[i]) != 0)
+      fail ("worker %d failed", i);
+  elapsed = clock_ns () - start;
+
+  for (i = 0; i < workers; i++)
+    read_result (i);
+
+  all_ops = 0;
+  for (op = 0; op < WL_OP_CNT; op++)
+    {
+      if (total.ops[op] == 0)
+        continue;
+      all_ops += total.ops[op];
+
+      snprintf (name, sizeof name, "workload-%s-rate", op_names[op]);
+      bench_report (name, total.ops[op] * 1000000000ull / elapsed, "ops/s");
+      snprintf (name, sizeof name, "workload-%s-p50", op_names[op]);
+      bench_report (name, percentile (op, 50), "ns");
+      snprintf (name, sizeof name, "workload-%s-p90", op_names[op]);
+      bench_report (name, percentile (op, 90), "ns");
+      snprintf (name, sizeof name, "workload-%s-p99", op_names[op]);
+      bench_report (name, percentile (op, 99), "ns");
+    }
+  bench_report ("workload-rate", all_ops * 1000000000ull / elapsed, "ops/s");
+  return 0;
+}
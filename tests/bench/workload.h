@@ -0,0 +1,61 @@
+#ifndef TESTS_BENCH_WORKLOAD_H
+#define TESTS_BENCH_WORKLOAD_H
+
+/* Shared by the workload driver and its worker processes.  Each
+   worker writes one struct workload_result to a file, which the
+   driver reads back and merges. */
+
+#include <stdint.h>
+
+/* Kinds of operation. */
+enum workload_op
+  {
+    WL_FILE,            /* Create, write, read back and remove a file. */
+    WL_MEM,             /* Touch pages of the anonymous working set. */
+    WL_MMAP,            /* Map a file, read every page, unmap it. */
+    WL_SPAWN,           /* Exec a child and wait for it. */
+    WL_OP_CNT
+  };
+
+/* Latencies are kept in a histogram with WL_SUB_BUCKETS buckets
+   per power of 2 of nanoseconds, so a percentile read from it is
+   within 1/WL_SUB_BUCKETS of the true value. */
+#define WL_SUB_BITS 2
+#define WL_SUB_BUCKETS (1 << WL_SUB_BITS)
+#define WL_BUCKETS (40 * WL_SUB_BUCKETS)
+
+/* Results of one worker. */
+struct workload_result
+  {
+    uint32_t ops[WL_OP_CNT];                    /* Operations done. */
+    uint32_t hist[WL_OP_CNT][WL_BUCKETS];       /* Latency histograms. */
+  };
+
+/* Returns the histogram bucket for a latency of NS nanoseconds. */
+static inline int
+workload_bucket (uint64_t ns)
+{
+  int msb, bucket;
+
+  if (ns < WL_SUB_BUCKETS)
+    return ns;
+  for (msb = 63; !(ns & (1ull << msb)); msb--)
+    continue;
+  bucket = ((msb - WL_SUB_BITS + 1) << WL_SUB_BITS)
+           + ((ns >> (msb - WL_SUB_BITS)) & (WL_SUB_BUCKETS - 1));
+  return bucket < WL_BUCKETS ? bucket : WL_BUCKETS - 1;
+}
+
+/* Returns the largest latency that falls in BUCKET. */
+static inline uint64_t
+workload_bucket_max (int bucket)
+{
+  int shift = (bucket >> WL_SUB_BITS) - 1;
+
+  if (bucket < WL_SUB_BUCKETS)
+    return bucket;
+  return (((uint64_t) (WL_SUB_BUCKETS + (bucket & (WL_SUB_BUCKETS - 1))) + 1)
+          << shift) - 1;
+}
+
+#endif /* tests/bench/workload.h */
@@ -0,0 +1,63 @@
+/* Checks that deadline reservations are refused when they are
+   malformed or would take more of the CPU than may be reserved,
+   and that dropping one, or exiting, makes room again. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func reserve_thread;
+static struct semaphore reserved;
+static bool result;
+
+/* Asks for RUNTIME/DEADLINE/PERIOD from another thread, so that
+   it adds to the reservation of the running one, and waits for
+   that thread to exit. */
+static bool
+reserve_other (int runtime, int deadline, int period) 
+{
+  int args[3] = {runtime, deadline, period};
+
+  sema_init (&reserved, 0);
+  thread_create ("other", PRI_DEFAULT, reserve_thread, args);
+  sema_down (&reserved);
+  timer_sleep (1);
+  return result;
+}
+
+static void
+check (bool ok, bool expected, const char *what) 
+{
+  msg ("%s: %s", what, ok ? "accepted" : "refused");
+  if (ok != expected)
+    fail ("%s should have been %s", what, expected ? "accepted" : "refused");
+}
+
+void
+test_edf_admission (void) 
+{
+  check (thread_set_deadline (6, 5, 10), false, "runtime past deadline");
+  check (thread_set_deadline (3, 12, 10), false, "deadline past period");
+  check (thread_set_deadline (-1, 5, 10), false, "negative runtime");
+  check (thread_set_deadline (5, 10, 10), true, "50% for this thread");
+  check (reserve_other (5, 10, 10), false, "50% for another");
+  check (reserve_other (4, 10, 10), true, "40% for another");
+  check (reserve_other (4, 10, 10), true, "40% after it exited");
+  check (thread_set_deadline (10, 10, 10), false, "growing to 100%");
+  check (thread_set_deadline (9, 10, 10), true, "growing to 90%");
+  check (reserve_other (1, 10, 10), false, "10% for another");
+  check (thread_set_deadline (0, 0, 0), true, "dropping the reservation");
+  check (reserve_other (9, 10, 10), true, "90% for another");
+}
+
+static void
+reserve_thread (void *args_) 
+{
+  int *args = args_;
+
+  result = thread_set_deadline (args[0], args[1], args[2]);
+  sema_up (&reserved);
+}
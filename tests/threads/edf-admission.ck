@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admission) begin
+(edf-admission) runtime past deadline: refused
+(edf-admission) deadline past period: refused
+(edf-admission) negative runtime: refused
+(edf-admission) 50% for this thread: accepted
+(edf-admission) 50% for another: refused
+(edf-admission) 40% for another: accepted
+(edf-admission) 40% after it exited: accepted
+(edf-admission) growing to 100%: refused
+(edf-admission) growing to 90%: accepted
+(edf-admission) 10% for another: refused
+(edf-admission) dropping the reservation: accepted
+(edf-admission) 90% for another: accepted
+(edf-admission) end
+EOF
+pass;
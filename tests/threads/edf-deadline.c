@@ -0,0 +1,69 @@
+/* Checks that a thread with a deadline reservation meets its
+   deadlines while CPU-bound threads of the same priority keep
+   the CPU busy.  In each period the thread does one tick of
+   work, well within its budget, and checks that it finished
+   before the deadline. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define HOG_CNT 3               /* CPU-bound threads. */
+#define PERIOD_CNT 10           /* Periods to check. */
+#define RUNTIME 3               /* Budget, in ticks. */
+#define DEADLINE 5              /* Deadline, in ticks. */
+#define PERIOD 10               /* Period, in ticks. */
+
+static thread_func hog_thread;
+static volatile bool done;
+static struct semaphore hogs_done;
+
+void
+test_edf_deadline (void) 
+{
+  int64_t start;
+  int missed = 0;
+  int i;
+
+  sema_init (&hogs_done, 0);
+  for (i = 0; i < HOG_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "hog %d", i);
+      thread_create (name, PRI_DEFAULT, hog_thread, NULL);
+    }
+
+  if (!thread_set_deadline (RUNTIME, DEADLINE, PERIOD))
+    fail ("reservation of %d/%d/%d ticks refused", RUNTIME, DEADLINE, PERIOD);
+  start = timer_ticks ();
+  for (i = 0; i < PERIOD_CNT; i++)
+    {
+      int64_t release = start + i * PERIOD;
+
+      timer_sleep_until (release);
+      while (timer_ticks () < release + 1)
+        continue;
+      if (timer_ticks () > release + DEADLINE)
+        missed++;
+    }
+  thread_set_deadline (0, 0, 0);
+
+  done = true;
+  for (i = 0; i < HOG_CNT; i++)
+    sema_down (&hogs_done);
+
+  if (missed > 0)
+    fail ("missed %d of %d deadlines", missed, PERIOD_CNT);
+  msg ("All %d deadlines met.", PERIOD_CNT);
+}
+
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (!done)
+    continue;
+  sema_up (&hogs_done);
+}
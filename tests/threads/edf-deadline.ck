@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline) begin
+(edf-deadline) All 10 deadlines met.
+(edf-deadline) end
+EOF
+pass;
@@ -0,0 +1,17 @@
+/* Passes pread() a buffer that starts in user memory but runs
+   past PHYS_BASE into the kernel.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  pread (handle, (char *) 0xbffffff0, 123, 0);
+  fail ("should not have survived pread()");
+}
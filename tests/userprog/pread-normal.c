@@ -0,0 +1,50 @@
+/* Reads and writes files at explicit offsets with pread() and
+   pwrite(), out of order, and checks that neither moves the file
+   position. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const size_t size = sizeof sample - 1;
+  const size_t half = size / 2;
+  char buf[sizeof sample];
+  int handle, byte_cnt;
+
+  /* Read the second half, then the first. */
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  byte_cnt = pread (handle, buf + half, size - half, half);
+  if (byte_cnt != (int) (size - half))
+    fail ("pread() returned %d instead of %zu", byte_cnt, size - half);
+  byte_cnt = pread (handle, buf, half, 0);
+  if (byte_cnt != (int) half)
+    fail ("pread() returned %d instead of %zu", byte_cnt, half);
+  compare_bytes (buf, sample, size, 0, "sample.txt");
+  if (tell (handle) != 0)
+    fail ("pread() moved the file position to %u", tell (handle));
+  byte_cnt = pread (handle, buf, sizeof buf, size);
+  if (byte_cnt != 0)
+    fail ("pread() at end of file returned %d", byte_cnt);
+  msg ("close \"sample.txt\"");
+  close (handle);
+
+  /* Write the second half, then the first. */
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  byte_cnt = pwrite (handle, sample + half, size - half, half);
+  if (byte_cnt != (int) (size - half))
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, size - half);
+  byte_cnt = pwrite (handle, sample, half, 0);
+  if (byte_cnt != (int) half)
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, half);
+  if (tell (handle) != 0)
+    fail ("pwrite() moved the file position to %u", tell (handle));
+  msg ("close \"test.txt\"");
+  close (handle);
+
+  check_file ("test.txt", sample, size);
+}
@@ -0,0 +1,52 @@
+/* Reads a file into several buffers with readv(), and writes
+   another from several buffers with writev(). */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const size_t size = sizeof sample - 1;
+  char a[10], b[50], c[sizeof sample];
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  /* Read into three buffers, the last one larger than what is
+     left of the file. */
+  iov[0].iov_base = a;
+  iov[0].iov_len = sizeof a;
+  iov[1].iov_base = b;
+  iov[1].iov_len = sizeof b;
+  iov[2].iov_base = c;
+  iov[2].iov_len = sizeof c;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("readv() returned %d instead of %zu", byte_cnt, size);
+  compare_bytes (a, sample, sizeof a, 0, "sample.txt");
+  compare_bytes (b, sample + sizeof a, sizeof b, sizeof a, "sample.txt");
+  compare_bytes (c, sample + sizeof a + sizeof b, size - sizeof a - sizeof b,
+                 sizeof a + sizeof b, "sample.txt");
+  msg ("close \"sample.txt\"");
+  close (handle);
+
+  /* Write the same file back out in three pieces. */
+  iov[0].iov_base = (char *) sample;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = (char *) sample + 1;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = (char *) sample + 1;
+  iov[2].iov_len = size - 1;
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("writev() returned %d instead of %zu", byte_cnt, size);
+  msg ("close \"test.txt\"");
+  close (handle);
+
+  check_file ("test.txt", sample, size);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-normal) begin
+(readv-normal) open "sample.txt"
+(readv-normal) close "sample.txt"
+(readv-normal) create "test.txt"
+(readv-normal) open "test.txt"
+(readv-normal) close "test.txt"
+(readv-normal) open "test.txt" for verification
+(readv-normal) verified contents of "test.txt"
+(readv-normal) close "test.txt"
+(readv-normal) end
+readv-normal: exit(0)
+EOF
+pass;
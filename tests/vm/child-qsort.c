@@ -22,10 +22,9 @@ main (int argc UNUSED, char *argv[])
 
   CHECK ((handle = open (argv[1])) > 1, "open \"%s\"", argv[1]);
 
-  size = read (handle, buf, sizeof buf);
+  size = pread (handle, buf, sizeof buf, 0);
   qsort_bytes (buf, sizeof buf);
-  seek (handle, 0);
-  write (handle, buf, size);
+  pwrite (handle, buf, size, 0);
   close (handle);
   
   return 72;
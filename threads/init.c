@@ -17,9 +17,14 @@
 #include "devices/rtc.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/irqsoff.h"
+#include "threads/lockstat.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/phase.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 #ifdef USERPROG
@@ -29,6 +34,7 @@
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
+#include "tests/bench/kernel.h"
 #include "tests/threads/tests.h"
 #endif
 #ifdef FILESYS
@@ -39,6 +45,7 @@
 #endif
 #ifdef VM
 #include "vm/swap.h"
+#include "vm/share.h"
 #endif
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -82,6 +89,7 @@ pintos_init (void)
 
   /* Clear BSS. */  
   bss_init ();
+  phase_begin ("boot");
 
   /* Break command line into arguments and parse options. */
   argv = read_command_line ();
@@ -100,6 +108,7 @@ pintos_init (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  trace_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -133,6 +142,7 @@ pintos_init (void)
 #ifdef VM
   locate_block_devices ();
   swap_init(); 
+  share_init();
 #endif
 
 
@@ -146,6 +156,7 @@ pintos_init (void)
   }
 
   /* Finish up. */
+  phase_begin ("shutdown");
   shutdown ();
   thread_exit ();
 }
@@ -241,6 +252,16 @@ read_command_line (void)
 static char **
 parse_options (char **argv) 
 {
+  /* Initialize the random number generator based on the system
+     time.  An "-rs" option below replaces this seed.
+
+     When running under Bochs, this is not enough by itself to
+     get a good seed value, because the pintos script sets the
+     initial time to a predictable value, not to the local time,
+     for reproducibility.  To fix this, give the "-r" option to
+     the pintos script to request real-time execution. */
+  random_init (rtc_get_time ());
+
   for (; *argv != NULL && **argv == '-'; argv++)
     {
       char *save_ptr;
@@ -269,6 +290,26 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-cfs"))
+        thread_cfs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-trace"))
+        trace_configure (value);
+      else if (!strcmp (name, "-phases"))
+        phase_enabled = true;
+#ifdef LOCKSTAT
+      else if (!strcmp (name, "-lockstat"))
+        lockstat_enabled = true;
+#endif
+#ifdef IRQSOFF
+      else if (!strcmp (name, "-irqsoff"))
+        irqsoff_enabled = true;
+#endif
+#ifdef PROFILE
+      else if (!strcmp (name, "-profile"))
+        profile_enabled = true;
+#endif
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -276,17 +317,9 @@ parse_options (char **argv)
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
+  if (thread_mlfqs && thread_cfs)
+    PANIC ("-mlfqs and -cfs cannot be used together");
 
-  /* Initialize the random number generator based on the system
-     time.  This has no effect if an "-rs" option was specified.
-
-     When running under Bochs, this is not enough by itself to
-     get a good seed value, because the pintos script sets the
-     initial time to a predictable value, not to the local time,
-     for reproducibility.  To fix this, give the "-r" option to
-     the pintos script to request real-time execution. */
-  random_init (rtc_get_time ());
-  
   return argv;
 }
 
@@ -300,7 +333,8 @@ run_task (char **argv)
 #ifdef USERPROG
   process_wait (process_execute (task));
 #else
-  run_test (task);
+  if (!run_bench (task))
+    run_test (task);
 #endif
   printf ("Execution of '%s' complete.\n", task);
 }
@@ -335,6 +369,7 @@ run_actions (char **argv)
   while (*argv != NULL)
     {
       const struct action *a;
+      char phase[32];
       int i;
 
       /* Find action name. */
@@ -350,6 +385,11 @@ run_actions (char **argv)
           PANIC ("action `%s' requires %d argument(s)", *argv, a->argc - 1);
 
       /* Invoke action and advance. */
+      if (a->argc > 1)
+        snprintf (phase, sizeof phase, "%s %s", argv[0], argv[1]);
+      else
+        strlcpy (phase, argv[0], sizeof phase);
+      phase_begin (phase);
       a->function (argv);
       argv += a->argc;
     }
@@ -392,6 +432,19 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -cfs               Use completely fair scheduler (not with -mlfqs).\n"
+          "  -tickless          Interrupt only for sleepers and time slices (not with -mlfqs).\n"
+          "  -trace[=EVENT,...] Trace EVENTs (default all), print them at shutdown.\n"
+          "  -phases            Print the cycles spent in each phase at shutdown.\n"
+#ifdef LOCKSTAT
+          "  -lockstat          Print lock contention statistics at shutdown.\n"
+#endif
+#ifdef IRQSOFF
+          "  -irqsoff           Print the longest interrupts-off stretches at shutdown.\n"
+#endif
+#ifdef PROFILE
+          "  -profile           Sample the running code on every timer tick.\n"
+#endif
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
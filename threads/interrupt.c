@@ -6,6 +6,7 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/irqsoff.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
@@ -56,6 +57,10 @@ static uint64_t make_intr_gate (void (*) (void), int dpl);
 static uint64_t make_trap_gate (void (*) (void), int dpl);
 static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 
+/* Interrupt flag helpers, CALLER is reported by the irqsoff tracer. */
+static enum intr_level enable (void *caller);
+static enum intr_level disable (void *caller);
+
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 static void unexpected_interrupt (const struct intr_frame *);
@@ -80,16 +85,37 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  void *caller = __builtin_return_address (0);
+  return level == INTR_ON ? enable (caller) : disable (caller);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) 
+{
+  return enable (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) 
+{
+  return disable (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+enable (void *caller UNUSED) 
 {
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+#ifdef IRQSOFF
+  if (old_level == INTR_OFF)
+    irqsoff_end (caller);
+#endif
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -99,9 +125,10 @@ intr_enable (void)
   return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) 
+/* Disables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+disable (void *caller UNUSED) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,6 +137,11 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+#ifdef IRQSOFF
+  if (old_level == INTR_ON)
+    irqsoff_begin (caller);
+#endif
+
   return old_level;
 }
 
@@ -352,6 +384,16 @@ intr_handler (struct intr_frame *frame)
      and they need to be acknowledged on the PIC (see below).
      An external interrupt handler cannot sleep. */
   external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+  handler = intr_handlers[frame->vec_no];
+
+  /* Entering the kernel from user mode (CPL 3). */
+  if ((frame->cs & 3) == 3)
+    thread_charge_user ();
+#ifdef IRQSOFF
+  /* Interrupt gates turn interrupts off on entry, trap gates do not. */
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    irqsoff_begin ((void *) handler);
+#endif
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
@@ -362,7 +404,6 @@ intr_handler (struct intr_frame *frame)
     }
 
   /* Invoke the interrupt's handler. */
-  handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
   else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
@@ -386,6 +427,15 @@ intr_handler (struct intr_frame *frame)
       if (yield_on_return) 
         thread_yield (); 
     }
+
+  if ((frame->cs & 3) == 3)
+    thread_charge_kernel ();
+
+#ifdef IRQSOFF
+  /* The iret turns interrupts back on. */
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    irqsoff_end ((void *) handler);
+#endif
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -0,0 +1,110 @@
+#include "threads/irqsoff.h"
+
+#ifdef IRQSOFF
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+
+/* Number of longest stretches to keep. */
+#define IRQSOFF_TOP 16
+
+/* A stretch with interrupts off. */
+struct irqsoff_window
+  {
+    void *start;                /* Code that turned interrupts off. */
+    void *end;                  /* Code that turned them back on. */
+    uint64_t cycles;            /* Longest time seen. */
+  };
+
+/* Longest stretches, longest first. */
+static struct irqsoff_window top[IRQSOFF_TOP];
+static size_t top_cnt;
+
+/* Stretch in progress. */
+static bool off;                /* Was irqsoff_begin() called? */
+static void *off_caller;        /* Its caller. */
+static uint64_t off_start;      /* Cycle count at irqsoff_begin(). */
+
+bool irqsoff_enabled;
+
+/* Records that CALLER just turned interrupts off. */
+void
+irqsoff_begin (void *caller)
+{
+  off = true;
+  off_caller = caller;
+  off_start = clock_cycles ();
+}
+
+/* Records that CALLER is about to turn interrupts back on, and
+   keeps the stretch if it is among the longest. */
+void
+irqsoff_end (void *caller)
+{
+  uint64_t cycles = clock_cycles () - off_start;
+  struct irqsoff_window w;
+  size_t i;
+
+  /* Interrupts were off since boot, or were turned off by code
+     that does not go through intr_disable(). */
+  if (!off)
+    return;
+  off = false;
+
+  /* Same code pair seen before?  Then only a longer stretch
+     replaces it. */
+  for (i = 0; i < top_cnt; i++)
+    if (top[i].start == off_caller && top[i].end == caller)
+      break;
+  if (i < top_cnt)
+    {
+      if (cycles <= top[i].cycles)
+        return;
+      w = top[i];
+    }
+  else
+    {
+      if (top_cnt == IRQSOFF_TOP && cycles <= top[top_cnt - 1].cycles)
+        return;
+      if (top_cnt < IRQSOFF_TOP)
+        top_cnt++;
+      i = top_cnt - 1;
+      w.start = off_caller;
+      w.end = caller;
+    }
+  w.cycles = cycles;
+
+  /* Move it up to its place. */
+  for (; i > 0 && top[i - 1].cycles < cycles; i--)
+    top[i] = top[i - 1];
+  top[i] = w;
+}
+
+/* Prints the longest stretches with interrupts off, if the
+   -irqsoff option was given. */
+void
+irqsoff_print_stats (void)
+{
+  static struct irqsoff_window snapshot[IRQSOFF_TOP];
+  enum intr_level old_level;
+  size_t cnt, i;
+
+  if (!irqsoff_enabled)
+    return;
+
+  /* Printing turns interrupts on and off itself, so copy first. */
+  old_level = intr_disable ();
+  cnt = top_cnt;
+  for (i = 0; i < cnt; i++)
+    snapshot[i] = top[i];
+  intr_set_level (old_level);
+
+  printf ("Longest interrupts-off stretches (cycles):\n");
+  printf ("%14s %10s %10s\n", "cycles", "off at", "on at");
+  for (i = 0; i < cnt; i++)
+    printf ("%14"PRIu64" %10p %10p\n", snapshot[i].cycles,
+            snapshot[i].start, snapshot[i].end);
+}
+#endif /* IRQSOFF */
@@ -0,0 +1,26 @@
+#ifndef THREADS_IRQSOFF_H
+#define THREADS_IRQSOFF_H
+
+/* Interrupts-off latency tracer.
+
+   Built only when IRQSOFF is defined, with `make IRQSOFF=1'.
+
+   Times every stretch with interrupts off, from the intr_disable()
+   or interrupt entry that turned them off to the intr_enable() or
+   interrupt return that turned them back on, in CPU cycles.  The
+   longest stretches are kept by (start, end) code address.  The
+   -irqsoff kernel option prints them at shutdown.  Feed the
+   addresses to the `backtrace' utility to get function names. */
+
+#ifdef IRQSOFF
+#include <stdbool.h>
+
+/* Print a report at shutdown?  Set by the -irqsoff option. */
+extern bool irqsoff_enabled;
+
+void irqsoff_begin (void *caller);
+void irqsoff_end (void *caller);
+void irqsoff_print_stats (void);
+#endif
+
+#endif /* threads/irqsoff.h */
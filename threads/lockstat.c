@@ -0,0 +1,139 @@
+#include "threads/lockstat.h"
+
+#ifdef LOCKSTAT
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+/* Maximum number of lock classes.  Locks of classes past the
+   limit are not counted. */
+#define LOCK_CLASS_CNT 64
+
+/* Statistics for all the locks initialized under one name. */
+struct lock_class
+  {
+    const char *name;           /* lock_init() argument. */
+    uint64_t acquired;          /* Number of acquisitions. */
+    uint64_t contended;         /* Acquisitions that had to wait. */
+    uint64_t wait_total;        /* Cycles spent waiting. */
+    uint64_t wait_max;          /* Longest wait. */
+    uint64_t hold_total;        /* Cycles held. */
+    uint64_t hold_max;          /* Longest hold. */
+  };
+
+static struct lock_class classes[LOCK_CLASS_CNT];
+static size_t class_cnt;
+
+bool lockstat_enabled;
+
+/* Puts LOCK in the class called NAME, creating it if needed. */
+void
+lockstat_init_lock (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+  size_t i;
+
+  if (name[0] == '&')
+    name++;
+
+  old_level = intr_disable ();
+  lock->class = NULL;
+  lock->acquired_at = 0;
+  for (i = 0; i < class_cnt; i++)
+    if (!strcmp (classes[i].name, name))
+      {
+        lock->class = &classes[i];
+        break;
+      }
+  if (lock->class == NULL && class_cnt < LOCK_CLASS_CNT)
+    {
+      lock->class = &classes[class_cnt++];
+      lock->class->name = name;
+    }
+  intr_set_level (old_level);
+}
+
+/* Records that the current thread acquired LOCK.  It started
+   trying at cycle START and had to wait if CONTENDED is true.
+   Interrupts must be off. */
+void
+lockstat_acquired (struct lock *lock, uint64_t start, bool contended)
+{
+  struct lock_class *c = lock->class;
+  uint64_t now = clock_cycles ();
+
+  lock->acquired_at = now;
+  if (c == NULL)
+    return;
+  c->acquired++;
+  if (contended)
+    {
+      uint64_t wait = now - start;
+      c->contended++;
+      c->wait_total += wait;
+      if (wait > c->wait_max)
+        c->wait_max = wait;
+    }
+}
+
+/* Records that the current thread is releasing LOCK.
+   Interrupts must be off. */
+void
+lockstat_released (struct lock *lock)
+{
+  struct lock_class *c = lock->class;
+  uint64_t hold;
+
+  if (c == NULL)
+    return;
+  hold = clock_cycles () - lock->acquired_at;
+  c->hold_total += hold;
+  if (hold > c->hold_max)
+    c->hold_max = hold;
+}
+
+/* Prints the lock classes that were ever acquired, sorted by
+   total wait time, if the -lockstat option was given. */
+void
+lockstat_print_stats (void)
+{
+  static struct lock_class snapshot[LOCK_CLASS_CNT];
+  enum intr_level old_level;
+  size_t cnt, i, j;
+
+  if (!lockstat_enabled)
+    return;
+
+  /* Printing takes the console lock, so copy first. */
+  old_level = intr_disable ();
+  cnt = 0;
+  for (i = 0; i < class_cnt; i++)
+    if (classes[i].acquired > 0)
+      snapshot[cnt++] = classes[i];
+  intr_set_level (old_level);
+
+  /* Insertion sort, most wait time first. */
+  for (i = 1; i < cnt; i++)
+    {
+      struct lock_class c = snapshot[i];
+      for (j = i; j > 0 && snapshot[j - 1].wait_total < c.wait_total; j--)
+        snapshot[j] = snapshot[j - 1];
+      snapshot[j] = c;
+    }
+
+  printf ("Lock contention (cycles):\n");
+  printf ("%-24s %10s %10s %14s %12s %14s %12s\n", "lock", "acquired",
+          "contended", "wait-total", "wait-max", "hold-total", "hold-max");
+  for (i = 0; i < cnt; i++)
+    {
+      struct lock_class *c = &snapshot[i];
+      printf ("%-24s %10"PRIu64" %10"PRIu64" %14"PRIu64" %12"PRIu64
+              " %14"PRIu64" %12"PRIu64"\n",
+              c->name, c->acquired, c->contended, c->wait_total,
+              c->wait_max, c->hold_total, c->hold_max);
+    }
+}
+#endif /* LOCKSTAT */
@@ -0,0 +1,32 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+/* Lock contention profiler.
+
+   Built only when LOCKSTAT is defined, with `make LOCKSTAT=1'.
+   Otherwise none of this exists and struct lock carries no
+   extra fields.
+
+   Every lock belongs to a class named after the argument of its
+   lock_init() call, such as "&file_system_lock" or "&d->lock"
+   for the malloc descriptors.  Each class counts acquisitions
+   and contended acquisitions, and adds up wait and hold times in
+   CPU cycles.  The -lockstat kernel option prints the classes at
+   shutdown, most waited on first. */
+
+#ifdef LOCKSTAT
+#include <stdbool.h>
+#include <stdint.h>
+
+struct lock;
+
+/* Print a report at shutdown?  Set by the -lockstat option. */
+extern bool lockstat_enabled;
+
+void lockstat_init_lock (struct lock *, const char *name);
+void lockstat_acquired (struct lock *, uint64_t start, bool contended);
+void lockstat_released (struct lock *);
+void lockstat_print_stats (void);
+#endif
+
+#endif /* threads/lockstat.h */
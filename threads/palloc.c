@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,7 +24,25 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool also keeps a small stack of pages that were zeroed
+   ahead of time by the idle thread.  Single-page PAL_ZERO
+   requests are served from that stack first, so the allocating
+   thread does not pay for the memset.  Pages on the stack are
+   marked used in the pool's bitmap; they are handed back when
+   the bitmap runs dry, along with the page being zeroed at that
+   moment, if any. */
+
+/* Maximum number of pre-zeroed pages kept by each pool. */
+#define ZERO_CACHE_SIZE 32
+
+/* A pool keeps at most one pre-zeroed page per this many pages,
+   so a small pool does not lose a large share of itself. */
+#define ZERO_CACHE_RATIO 64
+
+/* Bytes the idle thread zeroes per interrupts-off stretch. */
+#define ZERO_CHUNK 512
 
 /* A memory pool. */
 struct pool
@@ -31,6 +50,13 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+
+    /* Pre-zeroed pages.  Protected by disabling interrupts,
+       only the idle thread pushes onto it. */
+    void *zeroed[ZERO_CACHE_SIZE];      /* Stack of zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pages in ZEROED. */
+    size_t zeroed_max;                  /* Capacity of ZEROED in use. */
+    void *zeroing;                      /* Page the idle thread is zeroing. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +65,10 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void release_page (struct pool *, void *page);
+static void *zero_cache_pop (struct pool *);
+static bool zero_cache_drain (struct pool *);
+static bool prezero_pool (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -77,10 +107,26 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
+  /* A page zeroed by the idle thread saves us the memset. */
+  if (page_cnt == 1 && (flags & PAL_ZERO))
+    {
+      pages = zero_cache_pop (pool);
+      if (pages != NULL)
+        return pages;
+    }
+
   lock_acquire (&pool->lock);
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
   lock_release (&pool->lock);
 
+  /* Out of free pages: give the pre-zeroed ones back and retry. */
+  if (page_idx == BITMAP_ERROR && zero_cache_drain (pool))
+    {
+      lock_acquire (&pool->lock);
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      lock_release (&pool->lock);
+    }
+
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
@@ -148,6 +194,17 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes one free page ahead of time and keeps it for a later
+   PAL_ZERO request.  Called by the idle thread, which must never
+   sleep, so a pool whose lock is held is simply skipped.
+   Returns true if a page was zeroed, false if there was nothing
+   to do. */
+bool
+palloc_prezero_page (void)
+{
+  return prezero_pool (&kernel_pool) || prezero_pool (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -167,6 +224,11 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   lock_init (&p->lock);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
+  p->zeroed_cnt = 0;
+  p->zeroed_max = page_cnt / ZERO_CACHE_RATIO;
+  if (p->zeroed_max > ZERO_CACHE_SIZE)
+    p->zeroed_max = ZERO_CACHE_SIZE;
+  p->zeroing = NULL;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +242,118 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Pops a pre-zeroed page from POOL.  Returns a null pointer if
+   there is none. */
+static void *
+zero_cache_pop (struct pool *pool)
+{
+  enum intr_level old_level;
+  void *page = NULL;
+
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt > 0)
+    page = pool->zeroed[--pool->zeroed_cnt];
+  intr_set_level (old_level);
+
+  return page;
+}
+
+/* Marks PAGE, which was taken from POOL, free again. */
+static void
+release_page (struct pool *pool, void *page)
+{
+  size_t page_idx = pg_no (page) - pg_no (pool->base);
+
+  lock_acquire (&pool->lock);
+  ASSERT (bitmap_test (pool->used_map, page_idx));
+  bitmap_reset (pool->used_map, page_idx);
+  lock_release (&pool->lock);
+}
+
+/* Returns every pre-zeroed page of POOL to its free map, and the
+   page the idle thread is zeroing, which it then gives up.
+   Returns true if any page was released. */
+static bool
+zero_cache_drain (struct pool *pool)
+{
+  enum intr_level old_level;
+  void *page;
+  bool released = false;
+
+  while ((page = zero_cache_pop (pool)) != NULL)
+    {
+      release_page (pool, page);
+      released = true;
+    }
+
+  old_level = intr_disable ();
+  page = pool->zeroing;
+  pool->zeroing = NULL;
+  intr_set_level (old_level);
+  if (page != NULL)
+    {
+      release_page (pool, page);
+      released = true;
+    }
+  return released;
+}
+
+/* Takes one free page from POOL, zeroes it and pushes it onto the
+   pool's zeroed stack.  Returns true if a page was added. */
+static bool
+prezero_pool (struct pool *pool)
+{
+  enum intr_level old_level;
+  size_t page_idx = BITMAP_ERROR;
+  size_t ofs;
+  uint8_t *page;
+
+  /* Only the idle thread adds pages, so a stack with room now
+     still has room once the page is zeroed. */
+  if (pool->zeroed_cnt >= pool->zeroed_max)
+    return false;
+
+  /* The idle thread must not block or receive a donation.  With
+     interrupts off no thread can be waiting for the lock, so
+     trying it never blocks and releasing it never yields. */
+  old_level = intr_disable ();
+  if (lock_try_acquire (&pool->lock))
+    {
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, 1, false);
+      lock_release (&pool->lock);
+    }
+  if (page_idx == BITMAP_ERROR)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  page = pool->base + PGSIZE * page_idx;
+  pool->zeroing = page;
+  intr_set_level (old_level);
+
+  /* zero_cache_drain() may take the page back between chunks,
+     then stop writing to it. */
+  for (ofs = 0; ofs < PGSIZE; ofs += ZERO_CHUNK)
+    {
+      old_level = intr_disable ();
+      if (pool->zeroing != page)
+        {
+          intr_set_level (old_level);
+          return false;
+        }
+      memset (page + ofs, 0, ZERO_CHUNK);
+      intr_set_level (old_level);
+    }
+
+  old_level = intr_disable ();
+  if (pool->zeroing == page)
+    {
+      ASSERT (pool->zeroed_cnt < pool->zeroed_max);
+      pool->zeroing = NULL;
+      pool->zeroed[pool->zeroed_cnt++] = page;
+    }
+  intr_set_level (old_level);
+
+  return true;
+}
@@ -0,0 +1,86 @@
+#include "threads/phase.h"
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+
+/* Most phases kept.  Later phases are folded into the last. */
+#define PHASE_MAX 16
+
+/* A phase. */
+struct phase
+  {
+    char name[32];              /* Name, with no white space. */
+    uint64_t start;             /* clock_cycles() at its start. */
+    uint64_t idle_start;        /* thread_idle_cycles() at its start. */
+    uint64_t cycles;            /* Cycles, once ended. */
+    uint64_t busy;              /* Non-idle cycles, once ended. */
+  };
+
+static struct phase phases[PHASE_MAX];
+static size_t phase_cnt;
+
+bool phase_enabled;
+
+/* Ends the current phase, if any. */
+static void
+end_phase (void)
+{
+  struct phase *p;
+  uint64_t now, idle;
+
+  if (phase_cnt == 0)
+    return;
+  p = &phases[phase_cnt - 1];
+  now = clock_cycles ();
+  idle = thread_idle_cycles ();
+  p->cycles += now - p->start;
+  p->busy += (now - p->start) - (idle - p->idle_start);
+  p->start = now;
+  p->idle_start = idle;
+}
+
+/* Ends the current phase and starts one called NAME.  White
+   space in NAME becomes `-', so that the name is one word. */
+void
+phase_begin (const char *name)
+{
+  struct phase *p;
+  char *c;
+
+  end_phase ();
+  if (phase_cnt < PHASE_MAX)
+    {
+      p = &phases[phase_cnt++];
+      strlcpy (p->name, name, sizeof p->name);
+      for (c = p->name; *c != '\0'; c++)
+        if (*c == ' ')
+          *c = '-';
+    }
+  else
+    p = &phases[phase_cnt - 1];
+  p->start = clock_cycles ();
+  p->idle_start = thread_idle_cycles ();
+}
+
+/* Ends the current phase and prints all of them, if the -phases
+   option was given. */
+void
+phase_print_stats (void)
+{
+  size_t i;
+
+  end_phase ();
+  if (!phase_enabled)
+    return;
+
+  for (i = 0; i < phase_cnt; i++)
+    {
+      const struct phase *p = &phases[i];
+      printf ("BENCH phase.%s.busy %"PRIu64" cycles\n", p->name, p->busy);
+      printf ("BENCH phase.%s.time %"PRIu64" ns\n",
+              p->name, clock_cycles_to_ns (p->cycles));
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef THREADS_PHASE_H
+#define THREADS_PHASE_H
+
+/* Run phases.
+
+   The kernel splits a run into phases: "boot" up to the first
+   action, one phase per action, and "shutdown".  Each phase
+   counts the time-stamp counter cycles that passed and those
+   that the idle thread did not use.
+
+   With the -phases kernel option, the counts are printed at
+   shutdown as "BENCH" lines for utils/pintos-bench.  Under
+   `pintos --icount' QEMU's time-stamp counter advances by one
+   per instruction, in nanoseconds of virtual time, so the busy
+   count is the number of instructions run and both counts are
+   the same from one run to the next. */
+
+#include <stdbool.h>
+
+/* Print phases at shutdown?  Set by the -phases option. */
+extern bool phase_enabled;
+
+void phase_begin (const char *name);
+void phase_print_stats (void);
+
+#endif /* threads/phase.h */
@@ -0,0 +1,129 @@
+#include "threads/profile.h"
+
+#ifdef PROFILE
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Number of distinct (program, PC) pairs that can be counted.
+   Must be a power of 2. */
+#define PROFILE_SLOTS 4096
+
+/* Number of distinct user programs.  Samples from programs past
+   the limit are dropped. */
+#define PROFILE_PROGS 32
+
+/* Sample counts for one PC. */
+struct profile_slot
+  {
+    uint32_t pc;                /* Sampled EIP. */
+    uint16_t prog;              /* 0 for the kernel, else 1 + index in progs. */
+    uint32_t count;             /* Number of samples, 0 for a free slot. */
+  };
+
+/* Hash of PC counts.  Filled from the timer interrupt, so it is
+   a fixed table with linear probing. */
+static struct profile_slot slots[PROFILE_SLOTS];
+
+/* Names of the user programs seen. */
+static char progs[PROFILE_PROGS][16];
+static size_t prog_cnt;
+
+static uint64_t sample_cnt;     /* Samples taken. */
+static uint64_t dropped_cnt;    /* Samples with no room. */
+
+bool profile_enabled;
+
+/* Returns the number for the user program NAME, 0 if there is
+   no room for it. */
+static uint16_t
+prog_number (const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < prog_cnt; i++)
+    if (!strcmp (progs[i], name))
+      return i + 1;
+  if (prog_cnt == PROFILE_PROGS)
+    return 0;
+  strlcpy (progs[prog_cnt], name, sizeof progs[prog_cnt]);
+  return ++prog_cnt;
+}
+
+/* Counts a sample of the code interrupted by the interrupt with
+   frame F.  Called from the timer interrupt. */
+void
+profile_sample (const struct intr_frame *f)
+{
+  uint32_t pc = (uint32_t) f->eip;
+  uint16_t prog = 0;
+  size_t i, probes;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!profile_enabled)
+    return;
+  sample_cnt++;
+
+  /* User code runs with privilege level 3. */
+  if ((f->cs & 3) == 3)
+    {
+      prog = prog_number (thread_current ()->name);
+      if (prog == 0)
+        {
+          dropped_cnt++;
+          return;
+        }
+    }
+
+  i = ((pc >> 2) ^ (prog * 0x9e37u)) & (PROFILE_SLOTS - 1);
+  for (probes = 0; probes < PROFILE_SLOTS; probes++)
+    {
+      struct profile_slot *s = &slots[i];
+      if (s->count == 0)
+        {
+          s->pc = pc;
+          s->prog = prog;
+          s->count = 1;
+          return;
+        }
+      if (s->pc == pc && s->prog == prog)
+        {
+          s->count++;
+          return;
+        }
+      i = (i + 1) & (PROFILE_SLOTS - 1);
+    }
+  dropped_cnt++;
+}
+
+/* Prints the sample counts, if the -profile option was given. */
+void
+profile_print_stats (void)
+{
+  size_t i;
+
+  if (!profile_enabled)
+    return;
+
+  /* No more samples while printing. */
+  profile_enabled = false;
+
+  printf ("Profile: %"PRIu64" samples, %"PRIu64" dropped.\n",
+          sample_cnt, dropped_cnt);
+  for (i = 0; i < PROFILE_SLOTS; i++)
+    {
+      const struct profile_slot *s = &slots[i];
+      if (s->count == 0)
+        continue;
+      if (s->prog == 0)
+        printf ("PROF kernel 0x%08"PRIx32" %"PRIu32"\n", s->pc, s->count);
+      else
+        printf ("PROF user %s 0x%08"PRIx32" %"PRIu32"\n",
+                progs[s->prog - 1], s->pc, s->count);
+    }
+}
+#endif /* PROFILE */
@@ -0,0 +1,26 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+/* Sampling profiler.
+
+   Built only when PROFILE is defined, with `make PROFILE=1'.
+
+   With the -profile kernel option, every timer tick records the
+   interrupted EIP, counting kernel and user samples separately
+   and user samples per program.  The counts are printed at
+   shutdown as "PROF" lines, which utils/pintos-prof turns into a
+   flat profile. */
+
+#ifdef PROFILE
+#include <stdbool.h>
+
+struct intr_frame;
+
+/* Take samples?  Set by the -profile option. */
+extern bool profile_enabled;
+
+void profile_sample (const struct intr_frame *);
+void profile_print_stats (void);
+#endif
+
+#endif /* threads/profile.h */
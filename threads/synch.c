@@ -29,13 +29,15 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
-#include "malloc.h"
+#include "threads/lockstat.h"
 static int ids = 0;
-bool donations_value_less(const struct list_elem* a, const struct list_elem* b, void* aux UNUSED);
-bool sema_value_less(const struct list_elem* a, const struct list_elem* b, void* aux UNUSED);
-int search_lock_donated_priority (struct list *donations, struct lock *lock);
+static heap_less_func waiter_less;
+static heap_less_func cond_waiter_less;
+static heap_less_func lock_priority_less;
+static void donate_priority (struct lock *lock, int priority);
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -51,7 +53,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -73,7 +75,9 @@ sema_down (struct semaphore *sema)
   
   while (sema->value == 0) 
     {
-      list_insert_ordered(&sema->waiters, &thread_current ()->elem, priority_value_less, NULL);
+      struct thread *cur = thread_current ();
+      heap_push (&sema->waiters, &cur->wait_elem);
+      cur->wait_heap = &sema->waiters;
       thread_block ();
     }
   sema->value--;
@@ -121,18 +125,16 @@ sema_up (struct semaphore *sema)
   old_level = intr_disable ();
   
   struct thread *next_thread = NULL;
-  struct thread *cur = thread_current();
-  if (!list_empty (&sema->waiters)) 
+  if (!heap_empty (&sema->waiters)) 
   {
-    /* Ordering the list is necessary because the priority can change in excecution. */
-    list_sort (&sema->waiters, priority_value_less, NULL);                            
-
-    next_thread = list_entry (list_pop_back (&sema->waiters), struct thread, elem);
+    /* The heap is kept ordered when a waiter's priority changes, see waiter_requeue(). */
+    next_thread = heap_entry (heap_pop (&sema->waiters), struct thread, wait_elem);
+    next_thread->wait_heap = NULL;
     thread_unblock (next_thread);
   }
   sema->value++;
   
-  if (next_thread != NULL && !intr_context() && cur->priority < next_thread->priority){
+  if (next_thread != NULL && !intr_context() && thread_preempts (next_thread)){
     thread_yield();
   }
   
@@ -192,29 +194,78 @@ sema_test_helper (void *sema_)
    onerous, it's a good sign that a semaphore should be used,
    instead of a lock. */
 void
-lock_init (struct lock *lock)
+(lock_init) (struct lock *lock)
 {
   ASSERT (lock != NULL);
   lock->id = ids++;
   lock->holder = NULL;
-  lock->donated = NULL;
+  lock->max_priority = -1;
   sema_init (&lock->semaphore, 1);
 }
 
-struct list_elem *find_lock (struct list *donations, struct lock *lock)
+#ifdef LOCKSTAT
+/* Initializes LOCK like lock_init() and puts it in the lockstat class NAME. */
+void
+lock_init_named (struct lock *lock, const char *name)
+{
+  (lock_init) (lock);
+  lockstat_init_lock (lock, name);
+}
+#endif
+
+/* Initializes LOCKS, the heap of locks held by a thread, which keeps the lock
+   with the highest donated priority on top. */
+void
+held_locks_init (struct heap *locks)
+{
+  heap_init (locks, lock_priority_less, NULL);
+}
+
+/* Returns T's priority with donations: the highest of its own priority and 
+   the priorities donated to the locks it holds. Costs O(1), the held locks 
+   are kept in a heap. */
+int
+donated_priority (struct thread *t)
 {
-  struct list_elem *iter = list_begin(donations);
-  while (iter != list_end (donations))
+  int priority = t->original_priority;
+
+  if (!heap_empty (&t->locks))
   {
-    struct donation *d = list_entry(iter, struct donation, elem);
-    if (d->lock == lock) return iter;
-    iter = list_next(iter);
+    struct lock *top = heap_entry (heap_top (&t->locks), struct lock, elem);
+    if (top->max_priority > priority)
+      priority = top->max_priority;
   }
-  return NULL;
-  
+  return priority;
 }
 
+/* Returns true if the scheduler in use lets waiters donate their
+   priority to lock holders.  MLFQS computes priorities itself and
+   CFS does not look at them. */
+static bool
+priority_donation (void)
+{
+  return !thread_mlfqs && !thread_cfs;
+}
 
+/* Donates PRIORITY to the holder of LOCK, and on along the chain of locks 
+   the holders are waiting for. Stops as soon as a lock already has a donation 
+   that high, so there is no need for a hop limit. Interrupts must be off. */
+static void
+donate_priority (struct lock *lock, int priority)
+{
+  while (lock != NULL && lock->holder != NULL && lock->max_priority < priority)
+  {
+    struct thread *holder = lock->holder;
+
+    lock->max_priority = priority;
+    heap_update (&holder->locks, &lock->elem);
+    if (holder->priority >= priority)
+      break;
+    holder->priority = priority;
+    waiter_requeue (holder);
+    lock = holder->waiting;
+  }
+}
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
@@ -227,7 +278,6 @@ struct list_elem *find_lock (struct list *donations, struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
-  int cont = 0;
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
@@ -239,50 +289,31 @@ lock_acquire (struct lock *lock)
   old_level = intr_disable ();
 
   struct thread *cur = thread_current ();
-  struct thread *holder = lock->holder;
-  struct lock *lock_holder = lock;
-   
-  while(holder != NULL && cont < 8){
-    if (holder->priority < cur->priority)
-    {
-      struct list_elem *has_donation = find_lock (&holder->donations, lock_holder);           /* Gets all the donations from the holder. */
-      /* If the holder has no donations, a new donation is created and queued to the holder's donation list. */
-      if (has_donation == NULL)                                                               
-      {
-        struct donation *donor = malloc (sizeof (struct donation));
-        donor->priority = cur->priority;
-        donor->lock = lock_holder;
-        list_insert_ordered (&holder->donations, &donor->elem,donations_value_less, NULL);
-        holder->priority = donor->priority;
-        lock_holder->donated = donor;
-      }
-      /* Else, the donation is changed. */
-      else {
-        struct donation *previous = list_entry (has_donation, struct donation, elem);
-        if (previous->priority < cur->priority)
-        {
-          holder->priority = cur->priority;
-          previous->priority = cur->priority;
-          list_sort(&holder->donations,donations_value_less,NULL);
-        }
-      }
-    }
-    /* Change the current lock_holder for the holder's waiting. */
-    if(holder->waiting != NULL){
-      lock_holder = holder->waiting;
-      holder = holder->waiting->holder;
-    }else{
-      holder = NULL;
-      lock_holder = NULL;
-    }
-    cont++;
-  }
+#ifdef LOCKSTAT
+  uint64_t start = clock_cycles ();
+  bool contended = lock->semaphore.value == 0;
+#endif
+
+  /* The multilevel feedback queue and CFS schedulers do not use donations. */
+  if (priority_donation ())
+    donate_priority (lock, cur->priority);
 
   cur->waiting = lock;
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
-  list_push_back(&cur->locks, &lock->elem);
   cur->waiting = NULL;
+  lock->holder = cur;
+
+  /* The threads still waiting now donate to the new holder. */
+  if (heap_empty (&lock->semaphore.waiters))
+    lock->max_priority = -1;
+  else
+    lock->max_priority = heap_entry (heap_top (&lock->semaphore.waiters), struct thread, wait_elem)->priority;
+  heap_push (&cur->locks, &lock->elem);
+  if (priority_donation () && lock->max_priority > cur->priority)
+    cur->priority = lock->max_priority;
+#ifdef LOCKSTAT
+  lockstat_acquired (lock, start, contended);
+#endif
   intr_set_level (old_level);
 }
 
@@ -302,7 +333,18 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      /* Track it like lock_acquire() does, lock_release() expects
+         the lock to be in the holder's list. */
+      enum intr_level old_level = intr_disable ();
+      lock->holder = thread_current ();
+      lock->max_priority = -1;
+      heap_push (&lock->holder->locks, &lock->elem);
+#ifdef LOCKSTAT
+      lockstat_acquired (lock, clock_cycles (), false);
+#endif
+      intr_set_level (old_level);
+    }
   return success;
 }
 
@@ -321,24 +363,16 @@ lock_release (struct lock *lock)
 
   old_level = intr_disable ();
 
-  lock->holder = NULL;
   struct thread *cur = thread_current ();
 
-  if (lock->donated != NULL)
-  {
-    list_remove (&lock->donated->elem);
-    if (list_empty (&cur->donations))
-    {
-      cur->priority = cur->original_priority;
-      lock->donated = NULL;
-    }else {
-      struct donation *donations = list_entry (list_back (&cur->donations), struct donation, elem);
-      cur->priority = donations->priority;
-      lock->donated = donations;
-    }
-  }
-
-  list_remove(&lock->elem);
+#ifdef LOCKSTAT
+  lockstat_released (lock);
+#endif
+  heap_remove (&cur->locks, &lock->elem);
+  lock->holder = NULL;
+  lock->max_priority = -1;
+  if (priority_donation ())
+    cur->priority = donated_priority (cur);
 
   sema_up (&lock->semaphore);
   intr_set_level (old_level);
@@ -358,8 +392,9 @@ lock_held_by_current_thread (const struct lock *lock)
 /* One semaphore in a list. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct heap_elem elem;              /* Heap element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Waiting thread, gives the priority. */
   };
 
 /* Initializes condition variable COND.  A condition variable
@@ -370,7 +405,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -404,8 +439,14 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
- 	list_push_back (&cond->waiters, &waiter.elem);
-	
+  waiter.thread = thread_current ();
+
+  enum intr_level old_level = intr_disable ();
+  heap_push (&cond->waiters, &waiter.elem);
+  waiter.thread->cond_elem = &waiter.elem;
+  waiter.thread->cond_heap = &cond->waiters;
+  intr_set_level (old_level);
+
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
@@ -426,19 +467,13 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	void * aux = NULL;
-	// if (is_sorted(list_front(&cond->waiters), list_back(&cond->waiters), priority_value_less, aux))
-	// 	printf("is sorted");
-	
-	if (!list_empty (&cond->waiters)) {
-		// ordenar lista primero
-
-		list_sort (&cond->waiters, sema_value_less, aux);
-		
-		// list_reverse(&cond->waiters);
-
-		sema_up (&list_entry (list_pop_back (&cond->waiters), struct semaphore_elem, elem)->semaphore);
+	enum intr_level old_level = intr_disable ();
+	if (!heap_empty (&cond->waiters)) {
+		struct semaphore_elem *waiter = heap_entry (heap_pop (&cond->waiters), struct semaphore_elem, elem);
+		waiter->thread->cond_elem = NULL;
+		sema_up (&waiter->semaphore);
 	}
+	intr_set_level (old_level);
 }
 
 
@@ -454,12 +489,148 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 
 }
 
 
+/* Initializes RW as an unlocked reader-writer lock. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  lock_init (&rw->write_lock);
+  cond_init (&rw->readers_ok);
+  cond_init (&rw->writer_ok);
+  rw->readers = 0;
+  rw->writers = 0;
+}
+
+/* Acquires RW for reading, sleeping while a writer is inside or waiting. 
+   This function may sleep, so it must not be called within an interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  while (rw->writers > 0)
+  {
+    if (priority_donation ())
+    {
+      enum intr_level old_level = intr_disable ();
+      donate_priority (&rw->write_lock, thread_current ()->priority);
+      intr_set_level (old_level);
+    }
+    cond_wait (&rw->readers_ok, &rw->lock);
+  }
+  rw->readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. The last reader out lets 
+   a waiting writer in. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->writers > 0)
+    cond_signal (&rw->writer_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until the writers ahead and all readers are done. 
+   This function may sleep, so it must not be called within an interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  rw->writers++;
+  lock_release (&rw->lock);
+
+  lock_acquire (&rw->write_lock);
+
+  lock_acquire (&rw->lock);
+  while (rw->readers > 0)
+    cond_wait (&rw->writer_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing. If no other writer is 
+   waiting, wakes all the waiting readers at once. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (lock_held_by_current_thread (&rw->write_lock));
+
+  lock_acquire (&rw->lock);
+  if (--rw->writers == 0)
+    cond_broadcast (&rw->readers_ok, &rw->lock);
+  lock_release (&rw->lock);
+  lock_release (&rw->write_lock);
+}
+
+/* Initializes sequence lock SL. */
+void
+seqlock_init (struct seqlock *sl)
+{
+  ASSERT (sl != NULL);
+  sl->seq = 0;
+}
+
+/* Starts a read of the data SL protects and returns the sequence number to pass to 
+   seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *sl)
+{
+  unsigned seq;
+
+  while ((seq = *(volatile const unsigned *) &sl->seq) & 1)
+    continue;
+  barrier ();
+  return seq;
+}
+
+/* Returns true if the data SL protects was written since seqlock_read_begin() returned 
+   SEQ, in which case the read must be done again. */
+bool
+seqlock_read_retry (const struct seqlock *sl, unsigned seq)
+{
+  barrier ();
+  return *(volatile const unsigned *) &sl->seq != seq;
+}
+
+/* Starts a write of the data SL protects. Turns interrupts off and returns the old 
+   interrupt level for seqlock_write_end(). */
+enum intr_level
+seqlock_write_begin (struct seqlock *sl)
+{
+  enum intr_level old_level = intr_disable ();
+  sl->seq++;
+  barrier ();
+  return old_level;
+}
+
+/* Ends a write of the data SL protects and sets interrupts back to OLD_LEVEL. */
+void
+seqlock_write_end (struct seqlock *sl, enum intr_level old_level)
+{
+  barrier ();
+  sl->seq++;
+  intr_set_level (old_level);
+}
+
 /*
   Donor thread shares its priority to the thead that is holding the lock.
   If another high priority thread has already donated to lock holder, the highest priority stays. 
@@ -497,22 +668,39 @@ return_priority(struct lock *lock)
 */
 
 
-bool 
-donations_value_less(const struct list_elem* a, const struct list_elem* b, void* aux UNUSED)
+/* Orders held locks by the highest priority donated to them. */
+static bool 
+lock_priority_less (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
 {
-  const int a_member = (list_entry(a, struct thread, elem))->priority;
-  const int b_member = (list_entry(b, struct thread, elem))->priority;
-  return a_member < b_member;
+  return heap_entry (a, struct lock, elem)->max_priority
+         < heap_entry (b, struct lock, elem)->max_priority;
 }
 
-bool 
-sema_value_less(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED)
+/* Orders semaphore waiters by priority. */
+static bool 
+waiter_less (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
 {
-  struct semaphore_elem *a = list_entry (a_, struct semaphore_elem, elem);
-  struct semaphore_elem *b = list_entry (b_, struct semaphore_elem, elem);
+  return heap_entry (a, struct thread, wait_elem)->priority
+         < heap_entry (b, struct thread, wait_elem)->priority;
+}
+
+/* Orders condition waiters by the priority of the thread waiting in each semaphore_elem. */
+static bool 
+cond_waiter_less (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
+{
+  return heap_entry (a, struct semaphore_elem, elem)->thread->priority
+         < heap_entry (b, struct semaphore_elem, elem)->thread->priority;
+}
 
-  const struct thread *t1 = list_entry (list_front(&a->semaphore.waiters), struct thread, elem);
-  const struct thread *t2 = list_entry (list_front(&b->semaphore.waiters), struct thread, elem);
+/* Restores T's place in the semaphore and condition waiter heaps it is queued in.
+   Must be called with interrupts off after changing the priority of a thread that may be blocked. */
+void 
+waiter_requeue (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
 
-  return t1->priority <= t2->priority;
+  if (t->wait_heap != NULL)
+    heap_update (t->wait_heap, &t->wait_elem);
+  if (t->cond_elem != NULL)
+    heap_update (t->cond_heap, t->cond_elem);
 }
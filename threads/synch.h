@@ -2,15 +2,9 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <heap.h>
 #include <stdbool.h>
-
-/* Donations. */
-struct donation 
-  {
-    int priority;           /* Donated priority. */
-    struct lock *lock;      /* Lock of the donation. */
-    struct list_elem elem;
-  };
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 /* PintOS semaphores allow for n threads to access a critical code section. Not one thread can see the current
@@ -20,7 +14,7 @@ struct donation
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, highest priority on top. */
   };
 
 void sema_init (struct semaphore *, unsigned value);    
@@ -41,14 +35,25 @@ struct lock
     int id;                     /* Used to compare against other locks. */
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
-    struct list_elem elem;      /* Threads waiting for the lock to be released. */
-    struct donation *donated;   /* This structure has all the donation information of the current thread. */
+    struct heap_elem elem;      /* Element in the holder's heap of held locks. */
+    int max_priority;           /* Highest priority donated by a waiter, -1 if none. */
+#ifdef LOCKSTAT
+    struct lock_class *class;   /* Contention statistics, see lockstat.h. */
+    uint64_t acquired_at;       /* Cycle count at the last acquisition. */
+#endif
   };
 
-struct list_elem *find_lock (struct list *donations, struct lock *lock);
-int print_donos(struct list *donations);
+struct thread;
+void held_locks_init (struct heap *);
+/* Returns the priority of a thread with its donations: the highest of its own and its held locks'. */
+int donated_priority (struct thread *);
 
 void lock_init (struct lock *);
+#ifdef LOCKSTAT
+/* Names the lock's lockstat class after the argument, e.g. "&file_system_lock". */
+void lock_init_named (struct lock *, const char *name);
+#define lock_init(LOCK) lock_init_named (LOCK, #LOCK)
+#endif
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -65,7 +70,7 @@ bool lock_held_by_current_thread (const struct lock *);
    5. The lock is released. */ 
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting semaphore_elems, highest priority on top. */
   };
 
 void cond_init (struct condition *);
@@ -73,6 +78,54 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock. */
+/* Any number of readers or one writer at a time. Writers have preference: once a writer is waiting, 
+   new readers wait until all the writers are done, and then all of them are woken together. 
+   Writers queue on a plain lock, so a writer donates to the writer ahead of it, and readers 
+   waiting for a writer donate to it too. Readers do not receive donations. */
+struct rwlock 
+  {
+    struct lock lock;           /* Protects the fields below. */
+    struct lock write_lock;     /* Held by the writer inside. */
+    struct condition readers_ok;/* Readers waiting for the writers to finish. */
+    struct condition writer_ok; /* The writer waiting for the readers to leave. */
+    int readers;                /* Readers inside. */
+    int writers;                /* Writers inside or waiting. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
+/* Sequence lock. */
+/* For small, rarely written data that is read often, such as statistics. Readers never block or 
+   disable interrupts, they retry if a write happened while they were reading:
+
+      unsigned seq;
+      do 
+        {
+          seq = seqlock_read_begin (&sl);
+          ...copy the data...
+        }
+      while (seqlock_read_retry (&sl, seq));
+
+   Writers run with interrupts off, so they may write from an interrupt handler. */
+struct seqlock 
+  {
+    unsigned seq;               /* Odd while a write is in progress. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned seq);
+enum intr_level seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *, enum intr_level);
+
+/* Moves a waiting thread to its new place in the waiter queues after its priority changed. */
+void waiter_requeue (struct thread *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -11,6 +11,7 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/fixed-point.h"
 #ifdef USERPROG
@@ -28,26 +29,46 @@
 
 static int load_avg;          
 
-/* List of processes wainting for their sleeping time to end. */
+/* List of processes wainting for their sleeping time to end,
+   soonest first. */
 static struct list wait_sleeping_list;
 
 /* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
+   that are ready to run but not actually running.  Highest
+   priority at the back. */
 static struct list ready_list;
 
+/* Instead of ready_list with -cfs, least vruntime on top. */
+static struct heap cfs_queue;
+static unsigned long cfs_load;  /* Sum of the weights in cfs_queue. */
+static uint64_t min_vruntime;   /* Never decreasing vruntime floor. */
+
+/* Ready threads with a deadline reservation, earliest on top. */
+static struct heap edf_queue;
+
+/* Idle thread. */
+static struct thread *idle_thread;
+
+/* Pages of exited threads kept for new threads, only used with
+   interrupts off. */
+#define THREAD_CACHE_SIZE 8
+static struct thread *thread_cache[THREAD_CACHE_SIZE];
+static size_t thread_cache_cnt;
+
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Earliest deadline first reservations.  A thread with one runs
+   ahead of all others, earliest deadline first, for up to its
+   budget in each period; see thread_set_deadline(). */
+#define EDF_MAX_UTIL 900        /* Per mille of the CPU that
+                                   reservations may take. */
+static int edf_util;            /* Per mille taken by reservations. */
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
-
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -64,24 +85,77 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+static unsigned time_slice;     /* Ticks the running thread may run. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler instead of either.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler.
+
+   Each thread accumulates virtual runtime: the cycles it ran,
+   scaled by NICE_0_WEIGHT over the weight of its nice value, so
+   that a thread with twice the weight ages half as fast.  The
+   ready thread with the least vruntime runs next.  Its slice is
+   its weight's share of CFS_LATENCY ticks, in which every ready
+   thread should get to run once, but no less than
+   CFS_MIN_GRANULARITY ticks.  A thread that wakes up or is
+   created with less vruntime than the running one preempts it.
+   Priorities, and so priority donation, play no part. */
+#define CFS_LATENCY 6           /* Target latency, in timer ticks. */
+#define CFS_MIN_GRANULARITY 1   /* Shortest slice, in timer ticks. */
+#define NICE_0_WEIGHT 1024      /* Weight of nice 0. */
+
+/* Weights by nice value, from NICE_MIN to NICE_MAX.  Each step
+   is about 1.25 times the next, so one nice level is about a 10%
+   difference in CPU share. */
+static const unsigned cfs_weights[NICE_MAX - NICE_MIN + 1] =
+  {
+    88761, 71755, 56483, 46273, 36291,  /* -20 */
+    29154, 23254, 18705, 14949, 11916,  /* -15 */
+     9548,  7620,  6100,  4904,  3906,  /* -10 */
+     3121,  2501,  1991,  1586,  1277,  /*  -5 */
+     1024,   820,   655,   526,   423,  /*   0 */
+      335,   272,   215,   172,   137,  /*   5 */
+      110,    87,    70,    56,    45,  /*  10 */
+       36,    29,    23,    18,    15,  /*  15 */
+       12,                              /*  20 */
+  };
+
 static void kernel_thread (thread_func *, void *aux);
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
+static void ready_insert (struct thread *);
+static struct thread *ready_pop (void);
+static bool ready_empty (void);
+static int ready_max_priority (void);
+static size_t ready_count (void);
+static heap_less_func cfs_less;
+static heap_less_func edf_less;
+static void edf_replenish (struct thread *, int64_t now);
+static int64_t edf_tick_cycles (void);
+static void edf_charge (struct thread *);
+static void edf_throttle (struct thread *);
+static void edf_preempt (struct thread *);
+static void cfs_preempt (struct thread *);
+static void cfs_charge (struct thread *);
+static void cfs_place (struct thread *);
+static unsigned cfs_slice (struct thread *);
 static struct thread *next_thread_to_run (void);
+static void init_thread_page (struct thread *);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
-
-static struct thread *get_max_priority_thread(void);
+static struct thread *thread_page_alloc (void);
+static void thread_page_free (struct thread *);
 
 
 /* Initializes the threading system by transforming the code
@@ -102,10 +176,11 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
   list_init (&ready_list);
+  heap_init (&cfs_queue, cfs_less, NULL);
+  heap_init (&edf_queue, edf_less, NULL);
+  time_slice = TIME_SLICE;
   list_init (&all_list);
-  list_init (&all_files);
   list_init (&wait_sleeping_list);
 
 #ifdef VM
@@ -113,9 +188,12 @@ thread_init (void)
 #endif
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
+  init_thread_page (initial_thread);
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  initial_thread->cpu_mark = clock_cycles ();
+  initial_thread->exec_start = initial_thread->cpu_mark;
   load_avg = 0;                 /* Default value 0 */
 
 }
@@ -154,8 +232,38 @@ thread_tick (void)
   else
     kernel_ticks++;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  /* Enforce preemption.  A deadline thread is charged when it is
+     switched out; here it is only checked against its budget. */
+  if (t->dl_runtime > 0
+      && t->dl_left <= (int64_t) (clock_cycles () - t->dl_exec_start))
+    intr_yield_on_return ();
+  if (++thread_ticks >= time_slice)
+    intr_yield_on_return ();
+}
+
+/* Called by the timer interrupt handler in tickless mode, where
+   the timer interrupts only when a sleeper or the end of a time
+   slice is due.  ELAPSED ticks went by since the last interrupt;
+   they are all counted for the running thread.  SLICE_OVER tells
+   whether its time slice has run out. */
+void
+thread_tick_oneshot (int64_t elapsed, bool slice_over)
+{
+  struct thread *t = thread_current ();
+
+  /* Update statistics. */
+  if (t == idle_thread)
+    idle_ticks += elapsed;
+#ifdef USERPROG
+  else if (t->pagedir != NULL)
+    user_ticks += elapsed;
+#endif
+  else
+    kernel_ticks += elapsed;
+
+  /* Enforce preemption.  A deadline thread's slice ends when its
+     budget does. */
+  if (slice_over)
     intr_yield_on_return ();
 }
 
@@ -167,6 +275,87 @@ thread_print_stats (void)
           idle_ticks, kernel_ticks, user_ticks);
 }
 
+/* CPU time accounting.  The running thread's time is charged to
+   user or kernel time each time it enters or leaves the kernel,
+   and when it is switched out in schedule(), so every cycle is
+   counted once and none are sampled. */
+
+/* Charges the running thread's time since the last charge as
+   user time.  Called on entry to the kernel from user mode. */
+void
+thread_charge_user (void)
+{
+  struct thread *t = running_thread ();
+  uint64_t now = clock_cycles ();
+
+  t->user_cycles += now - t->cpu_mark;
+  t->cpu_mark = now;
+}
+
+/* Charges the running thread's time since the last charge as
+   kernel time.  Called on return to user mode. */
+void
+thread_charge_kernel (void)
+{
+  struct thread *t = running_thread ();
+  uint64_t now = clock_cycles ();
+
+  t->kernel_cycles += now - t->cpu_mark;
+  t->cpu_mark = now;
+}
+
+/* Fills in *S with the resource usage of thread T.  S->frames is
+   left as T counted it, which the VM does not; see
+   frame_owned_cnt().  Interrupts must be off. */
+void
+thread_get_stats (struct thread *t, struct procstat *s)
+{
+  uint64_t kernel_cycles = t->kernel_cycles;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* The running thread is in the kernel, asking. */
+  if (t == running_thread ())
+    kernel_cycles += clock_cycles () - t->cpu_mark;
+
+  *s = t->stats;
+  s->tid = t->tid;
+  strlcpy (s->name, t->name, sizeof s->name);
+  s->priority = t->priority;
+  s->user_ns = clock_cycles_to_ns (t->user_cycles);
+  s->kernel_ns = clock_cycles_to_ns (kernel_cycles);
+}
+
+/* Fills in up to MAX elements of STATS with the resource usage
+   of every thread, in creation order.  Returns the number of
+   threads, which may be more than MAX. */
+int
+thread_get_all_stats (struct procstat *stats, int max)
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+  int cnt = 0;
+
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      if (cnt < max)
+        thread_get_stats (list_entry (e, struct thread, allelem),
+                          &stats[cnt]);
+      cnt++;
+    }
+  intr_set_level (old_level);
+  return cnt;
+}
+
+/* Returns the cycles the idle thread has run, up to its last
+   switch or interrupt. */
+uint64_t
+thread_idle_cycles (void)
+{
+  return idle_thread != NULL ? idle_thread->kernel_cycles : 0;
+}
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -191,12 +380,13 @@ thread_create (const char *name, int priority,
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
   tid_t tid;
+  enum intr_level old_level;
+  bool preempt;
   struct thread *cur = thread_current();
   ASSERT (function != NULL);
 
   /* Allocate thread. */
- 
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_alloc ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -224,9 +414,11 @@ thread_create (const char *name, int priority,
   /* Add to run queue. */
   thread_unblock (t);
 
-  if (thread_current ()->priority < t->priority){
-    thread_yield();
-  }
+  old_level = intr_disable ();
+  preempt = thread_preempts (t);
+  intr_set_level (old_level);
+  if (preempt)
+    thread_yield ();
 
   // If it's MLFQS
   if (thread_mlfqs){
@@ -274,13 +466,42 @@ thread_unblock (struct thread *t)
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
 
-  /* Inserts the thread to the ready_list based on its priority. */
-  list_insert_ordered(&ready_list, &t->elem, priority_value_less, NULL);
+  /* Inserts the thread to the ready_list based on its
+     priority.  A deadline thread that used up its budget and then
+     blocked waits for its next period, see ready_insert(). */
+  if (thread_cfs && t->dl_runtime == 0)
+    cfs_place (t);
+  ready_insert (t);
+  edf_preempt (t);
+  cfs_preempt (t);
 
   t->status = THREAD_READY;
+  TRACE (TRACE_WAKEUP, t->tid, t->priority, 0);
   intr_set_level (old_level);
 }
 
+/* Returns true if T, just made ready, should run before the
+   running thread.  With -cfs that is if T has the smaller
+   vruntime once the running thread is charged for its time so
+   far, deadline threads being left to edf_preempt().  Otherwise
+   it is if T has the higher priority.  Interrupts must be off. */
+bool
+thread_preempts (struct thread *t) 
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!thread_cfs)
+    return cur->priority < t->priority;
+  if (cur == idle_thread)
+    return true;
+  if (t->dl_runtime > 0 || cur->dl_runtime > 0)
+    return false;
+  cfs_charge (cur);
+  return cfs_less (&cur->run_elem, &t->run_elem, NULL);
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void) 
@@ -329,6 +550,7 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  edf_util -= thread_current ()->dl_util;
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -347,7 +569,13 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_insert_ordered (&ready_list, &cur->elem, priority_value_less, NULL);
+    {
+      if (thread_cfs)
+        cfs_charge (cur);
+      if (cur->dl_runtime > 0)
+        edf_charge (cur);
+      ready_insert (cur);
+    }
 
   cur->status = THREAD_READY;
   
@@ -355,9 +583,21 @@ thread_yield (void)
   intr_set_level (old_level);
 }
 
-/* Inserts a thread into the wait_sleeping_list. */
+/* Returns true if thread A wakes up before thread B. */
+static bool
+wakes_earlier (const struct list_elem *a_, const struct list_elem *b_,
+               void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+  return a->time_sleeping < b->time_sleeping;
+}
+
+/* Inserts a thread into the wait_sleeping_list, to sleep until
+   timer time WAKE: a tick count, or a clock_cycles() value in
+   tickless mode.  See timer_sleep(). */
 void 
-insert_in_waiting_list(int64_t ticks)
+insert_in_waiting_list(int64_t wake)
 {
   /* Disable interruptions. */
   enum intr_level old_level;
@@ -366,17 +606,18 @@ insert_in_waiting_list(int64_t ticks)
   /* Remove current thread from "ready_list" and insert int to "wait_sleeping_list". 
      Change thread status to THREAD_BLOCKED and define sleeping time. */  
   struct thread *thread_actual = thread_current ();
-  thread_actual->time_sleeping = timer_ticks() + ticks;  
-  list_push_back(&wait_sleeping_list, &thread_actual->elem);
+  thread_actual->time_sleeping = wake;
+  list_insert_ordered(&wait_sleeping_list, &thread_actual->elem, wakes_earlier, NULL);
   thread_block();
 
   /* Enable interruptions. */
   intr_set_level (old_level);
 }
 
-/* Removes a thread from the wait_sleeping_list. */
+/* Removes a thread from the wait_sleeping_list. NOW is the timer time, in the
+   units given to insert_in_waiting_list(). */
 void 
-remover_thread_durmiente(int64_t ticks)
+remover_thread_durmiente(int64_t now)
 {
   /* When a timer_interrupt occurs, if time_sleeping has passed then the thread is 
      unblocked and put back to the ready_list. */
@@ -386,24 +627,30 @@ remover_thread_durmiente(int64_t ticks)
   while(iter != list_end(&wait_sleeping_list) ){
     struct thread *thread_lista_espera = list_entry(iter, struct thread, elem);    
     
-    /* If ticks is grater than the thread's time_sleeping then it needs to be awakened. */
-    if(ticks >= thread_lista_espera->time_sleeping){
+    /* If now is grater than the thread's time_sleeping then it needs to be awakened. */
+    if(now >= thread_lista_espera->time_sleeping){
       iter = list_remove(iter);               /* Removes the thread from wait_sleeping_list. */
-      thread_unblock(thread_lista_espera);    /* Unblocks the thread. i.e. Put the thread back in the ready_list. */
-    /* Else, continues with the next thread. */
+      if (thread_lista_espera->status == THREAD_READY){
+        /* A throttled deadline thread, its next period has started. */
+        ready_insert(thread_lista_espera);
+        edf_preempt(thread_lista_espera);
+      }else
+        thread_unblock(thread_lista_espera);  /* Unblocks the thread. i.e. Put the thread back in the ready_list. */
+    /* Else, the rest of the list sleeps even longer. */
     }else{
-      iter = list_next(iter);
+      break;
     }
   }
 }
 
-/* Gets the max priority thread in ready list. */
-static struct thread 
-*get_max_priority_thread()
+/* Returns the timer time the first sleeping thread wakes up at,
+   or INT64_MAX if no thread is sleeping. */
+int64_t
+thread_next_wakeup (void)
 {
-  struct list_elem *element = list_max(&ready_list, value_less, NULL);
-  struct thread *max_priority_thread = list_entry(element, struct thread, elem);
-  return max_priority_thread;
+  if (list_empty (&wait_sleeping_list))
+    return INT64_MAX;
+  return list_entry (list_front (&wait_sleeping_list), struct thread, elem)->time_sleeping;
 }
 
 /*
@@ -456,17 +703,25 @@ thread_set_priority (int new_priority)
   ASSERT (new_priority >= 0);
   ASSERT (new_priority < 64);
   
-  const struct thread *max_priority_thread = get_max_priority_thread();
+  int max_ready_priority = ready_max_priority ();
   struct thread *cur = thread_current();
+  if (thread_cfs)
+  {
+    /* CFS orders threads by vruntime, priority changes nothing. */
+    cur->priority = new_priority;
+    cur->original_priority = new_priority;
+    return;
+  }
   if (cur->original_priority != cur->priority)
   {
-    if (cur->priority <= new_priority){
-      cur->original_priority = cur->priority = new_priority;
-    }else 
-      cur->original_priority = new_priority;
+    /* Keep the donated priority if it is higher. */
+    enum intr_level old_level = intr_disable ();
+    cur->original_priority = new_priority;
+    cur->priority = donated_priority(cur);
+    intr_set_level (old_level);
     return;
   }
-  if ((new_priority < max_priority_thread->priority) || new_priority == 0){
+  if ((new_priority < max_ready_priority) || new_priority == 0){
     thread_current ()->priority = new_priority;
     thread_current ()->original_priority = new_priority;
     thread_yield();  
@@ -524,6 +779,7 @@ recalculate_priority(struct thread *current_thread, void *aux UNUSED )
       */
       if (current_thread->priority < PRI_MIN) current_thread->priority = PRI_MIN; 
       else if (current_thread->priority > PRI_MAX) current_thread->priority = PRI_MAX;
+      waiter_requeue (current_thread);
     }
 }
 
@@ -572,7 +828,7 @@ calculate_load_avg(void){
   int list_ready_threads;
   struct thread *cur;
 
-  list_ready_threads =list_size(&ready_list);
+  list_ready_threads = ready_count ();
   cur = thread_current();
 
   if (cur != idle_thread) ready_threads = list_ready_threads + 1;
@@ -595,6 +851,15 @@ thread_set_nice (int nice UNUSED)
   struct thread *curr;
 
   curr = thread_current ();
+  if (thread_cfs)
+    {
+      /* The new weight counts from now on. */
+      enum intr_level old_level = intr_disable ();
+      cfs_charge (curr);
+      curr->nice = nice;
+      intr_set_level (old_level);
+      return;
+    }
   curr->nice = nice;
   //vuelve a calcular la prioridad, pero basandose en MLFQS
   recalculate_priority(thread_current(),NULL);
@@ -606,12 +871,12 @@ thread_set_nice (int nice UNUSED)
   if (curr != idle_thread){
     if (curr->status == THREAD_READY){
       enum intr_level old_level;
-      old_level = intr_disable(); 
+      old_level = intr_disable (); 
       list_remove(&curr->elem); 
       list_insert_ordered (&ready_list, &curr->elem, priority_value_less, NULL);
       intr_set_level (old_level);
     } else if (curr->status == THREAD_RUNNING){
-      if (list_entry (list_begin (&ready_list), struct thread, elem)->priority > curr->priority) {
+      if (ready_max_priority () > curr->priority) {
         thread_yield();
       }
     }
@@ -660,9 +925,9 @@ priority_value_less(const struct list_elem *a_, const struct list_elem *b_, void
    thread_start().  It will be scheduled once initially, at which
    point it initializes idle_thread, "up"s the semaphore passed
    to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   blocks.  After that, the idle thread never appears in a run
+   queue.  It is returned by next_thread_to_run() as a special
+   case when there is nothing else to run. */
 static void
 idle (void *idle_started_ UNUSED) 
 {
@@ -672,6 +937,11 @@ idle (void *idle_started_ UNUSED)
 
   for (;;) 
     {
+      /* Spend spare cycles zeroing pages for later PAL_ZERO
+         requests, but stop as soon as there is real work. */
+      while (ready_empty () && palloc_prezero_page ())
+        continue;
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
@@ -735,36 +1005,52 @@ init_thread (struct thread *t, const char *name, int priority)
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
 
-
-  memset (t, 0, sizeof *t);
+  /* The page may come from the thread cache, so every field the
+     last thread changed is reset here; init_thread_page() set up
+     the rest. */
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
   t->original_priority = priority;
-  list_init(&t->locks);
-  list_init(&t->donations);
-#ifdef USERPROG
+  t->wait_heap = NULL;
+  t->cond_elem = NULL;
   t->waiting = NULL;
+  t->lock_holder = NULL;
+#ifdef USERPROG
+  t->child_load = false;
+  t->child_status = false;
   t->children_init=false;
-  t->fd_next = 2;
+  t->fd_table = NULL;
+  t->fd_map = NULL;
+  t->fd_cap = 0;
   t->fd_exec = -1;
-  list_init (&t->files);
-  sema_init(&t->exec_sema, 0);
-  // sema_init(&t->wait_sema, 0);
-  // lock_init(&t->process_lock);
-  // cond_init(&t->msg_parent);
-  lock_init(&t->wait_lock);
-  cond_init(&t->wait_cond);
-
+  /* exec() skips the down when the child signalled first. */
+  t->exec_sema.value = 0;
+  t->pagedir = NULL;
 #endif
 #ifdef VM
   t->esp = NULL; 
-  t->fault_addr = NULL; 
   t->on_syscall = false;
   t->mapid = 0; 
+  t->evicting = 0;
 #endif
+  memset (&t->stats, 0, sizeof t->stats);
+  t->user_cycles = 0;
+  t->kernel_cycles = 0;
+  t->cpu_mark = 0;
+  t->nice = 0;
+  t->recent_cpu = 0;
+  t->vruntime = 0;
+  t->exec_start = 0;
+  t->dl_runtime = 0;
+  t->dl_deadline = 0;
+  t->dl_period = 0;
+  t->dl_start = 0;
+  t->dl_left = 0;
+  t->dl_exec_start = 0;
+  t->dl_util = 0;
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -773,6 +1059,14 @@ init_thread (struct thread *t, const char *name, int priority)
 
   intr_set_level (old_level);
 
+  if (thread_cfs)
+    {
+      /* Inherit the creator's nice, and start level with the
+         threads already there. */
+      t->nice = t == initial_thread ? NICE_DEFAULT : thread_current ()->nice;
+      t->vruntime = min_vruntime;
+    }
+
   if (thread_mlfqs){
     //si es el primer thread, se inicializa nice y recent_cpu en 0, si no, entonces se toma el de parent
     if (t== initial_thread){
@@ -786,6 +1080,26 @@ init_thread (struct thread *t, const char *name, int priority)
   }
 }
 
+/* Clears the struct thread at the bottom of page T and sets up
+   the state an exiting thread leaves as it found it: its held
+   locks heap and the synchronization objects and lists that are
+   empty again by then.  Called once per page, a page taken from
+   the thread cache keeps them from its last thread. */
+static void
+init_thread_page (struct thread *t)
+{
+  memset (t, 0, sizeof *t);
+  held_locks_init (&t->locks);
+#ifdef USERPROG
+  sema_init (&t->exec_sema, 0);
+  lock_init (&t->wait_lock);
+  cond_init (&t->wait_cond);
+#endif
+#ifdef VM
+  list_init (&t->pinned_frames);
+#endif
+}
+
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
    returns a pointer to the frame's base. */
 static void *
@@ -799,19 +1113,289 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
-/* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+/* Adds ready thread T to the run queue that fits its scheduling
+   class.  A deadline thread out of budget is throttled instead. */
+static void
+ready_insert (struct thread *t)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (t->dl_runtime > 0)
+    {
+      edf_replenish (t, timer_ticks ());
+      if (t->dl_left > 0)
+        heap_push (&edf_queue, &t->run_elem);
+      else
+        edf_throttle (t);
+    }
+  else if (thread_cfs)
+    {
+      heap_push (&cfs_queue, &t->run_elem);
+      cfs_load += cfs_weights[t->nice - NICE_MIN];
+    }
+  else
+    list_insert_ordered (&ready_list, &t->elem, priority_value_less, NULL);
+  intr_set_level (old_level);
+}
+
+/* Removes and returns the highest priority ready thread, or a
+   null pointer if there is none. */
+static struct thread *
+ready_pop (void)
+{
+  enum intr_level old_level = intr_disable ();
+  struct thread *t = NULL;
+
+  if (!heap_empty (&edf_queue))
+    t = heap_entry (heap_pop (&edf_queue), struct thread, run_elem);
+  else if (thread_cfs)
+    {
+      if (!heap_empty (&cfs_queue))
+        {
+          t = heap_entry (heap_pop (&cfs_queue), struct thread, run_elem);
+          cfs_load -= cfs_weights[t->nice - NICE_MIN];
+          if (t->vruntime > min_vruntime)
+            min_vruntime = t->vruntime;
+        }
+    }
+  else if (!list_empty (&ready_list))
+    t = list_entry (list_pop_back (&ready_list), struct thread, elem);
+  intr_set_level (old_level);
+  return t;
+}
+
+/* Returns true if no thread is ready. */
+static bool
+ready_empty (void)
+{
+  if (!heap_empty (&edf_queue))
+    return false;
+  if (thread_cfs)
+    return heap_empty (&cfs_queue);
+  return list_empty (&ready_list);
+}
+
+/* Returns the priority of the highest priority ready thread, or
+   PRI_MIN - 1 if none is ready.  With -cfs, returns the priority
+   of the thread that runs next instead.  A ready deadline thread
+   counts as PRI_MAX + 1, above all others.  Interrupts may be
+   on, so the answer can be stale by the time it is used. */
+static int
+ready_max_priority (void)
+{
+  struct list *l = &ready_list;
+
+  if (ready_empty ())
+    return PRI_MIN - 1;
+  if (!heap_empty (&edf_queue))
+    return PRI_MAX + 1;
+  if (thread_cfs)
+    return heap_entry (heap_top (&cfs_queue), struct thread,
+                       run_elem)->priority;
+  return list_entry (list_back (l), struct thread, elem)->priority;
+}
+
+/* Returns the number of ready threads. */
+static size_t
+ready_count (void)
+{
+  return (heap_size (&edf_queue)
+          + (thread_cfs ? heap_size (&cfs_queue) : list_size (&ready_list)));
+}
+
+/* Orders threads in a cfs_queue.  The heap keeps its greatest
+   element on top, so the least vruntime is the greatest. */
+static bool
+cfs_less (const struct heap_elem *a_, const struct heap_elem *b_,
+          void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, run_elem);
+  const struct thread *b = heap_entry (b_, struct thread, run_elem);
+
+  return a->vruntime > b->vruntime;
+}
+
+/* Adds the cycles running thread T ran since it was last charged
+   to its vruntime, weighted by its nice value.  T must not be in
+   a cfs_queue. */
+static void
+cfs_charge (struct thread *t)
+{
+  uint64_t now = clock_cycles ();
+
+  t->vruntime += (now - t->exec_start) * NICE_0_WEIGHT
+                 / cfs_weights[t->nice - NICE_MIN];
+  t->exec_start = now;
+}
+
+/* Sets the vruntime of T, which is waking up, no further than
+   half a target latency behind min_vruntime.  A thread
+   that slept a long time then runs soon, but cannot take the CPU
+   for as long as it slept. */
+static void
+cfs_place (struct thread *t)
+{
+  uint64_t credit = clock_hz () * CFS_LATENCY / TIMER_FREQ / 2;
+  uint64_t min = min_vruntime;
+
+  if (min > credit && t->vruntime < min - credit)
+    t->vruntime = min - credit;
+}
+
+/* Returns the slice, in ticks, for thread T about to run on C:
+   its weight's share of the target latency, stretched so that
+   no slice is shorter than CFS_MIN_GRANULARITY. */
+static unsigned
+cfs_slice (struct thread *t)
+{
+  unsigned long weight = cfs_weights[t->nice - NICE_MIN];
+  unsigned period = CFS_LATENCY;
+  unsigned slice;
+
+  if ((heap_size (&cfs_queue) + 1) * CFS_MIN_GRANULARITY > period)
+    period = (heap_size (&cfs_queue) + 1) * CFS_MIN_GRANULARITY;
+  slice = period * weight / (cfs_load + weight);
+  return slice > CFS_MIN_GRANULARITY ? slice : CFS_MIN_GRANULARITY;
+}
+
+/* Orders threads in an edf_queue.  The heap keeps its greatest
+   element on top, so the earliest deadline is the greatest. */
+static bool
+edf_less (const struct heap_elem *a_, const struct heap_elem *b_,
+          void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, run_elem);
+  const struct thread *b = heap_entry (b_, struct thread, run_elem);
+
+  return a->dl_start + a->dl_deadline > b->dl_start + b->dl_deadline;
+}
+
+/* Moves deadline thread T to the period that timer tick NOW falls
+   in, with a full budget, if its current period is over. */
+static void
+edf_replenish (struct thread *t, int64_t now)
+{
+  if (now >= t->dl_start + t->dl_period)
+    {
+      t->dl_start += (now - t->dl_start) / t->dl_period * t->dl_period;
+      t->dl_left = t->dl_runtime * edf_tick_cycles ();
+    }
+}
+
+/* Returns the length of a timer tick in cycles.  Budgets are
+   reserved in ticks but charged in cycles. */
+static int64_t
+edf_tick_cycles (void)
+{
+  return clock_hz () / TIMER_FREQ;
+}
+
+/* Charges deadline thread T, which is leaving the CPU, for the
+   cycles it ran since it was last charged. */
+static void
+edf_charge (struct thread *t)
+{
+  uint64_t now = clock_cycles ();
+
+  t->dl_left -= now - t->dl_exec_start;
+  t->dl_exec_start = now;
+}
+
+/* Keeps deadline thread T, which is out of budget, off the run
+   queues until its next period starts.  T stays THREAD_READY and
+   waits in the sleep list, from which remover_thread_durmiente()
+   queues it again.  Interrupts must be off. */
+static void
+edf_throttle (struct thread *t)
+{
+  t->time_sleeping = timer_wake_time (t->dl_start + t->dl_period);
+  list_insert_ordered (&wait_sleeping_list, &t->elem, wakes_earlier, NULL);
+}
+
+/* Preempts the running thread for T, just queued by an interrupt
+   handler, if it has run less, see thread_preempts().  Without
+   -cfs, wakeups in interrupt handlers do not preempt. */
+static void
+cfs_preempt (struct thread *t)
+{
+  if (thread_cfs && intr_context () && thread_preempts (t))
+    intr_yield_on_return ();
+}
+
+/* Preempts the running thread for deadline thread T, just queued
+   by an interrupt handler, if T's deadline is earlier or the
+   running thread has none. */
+static void
+edf_preempt (struct thread *t)
+{
+  struct thread *cur;
+
+  if (t->dl_runtime == 0 || t->dl_left <= 0 || !intr_context ())
+    return;
+  cur = thread_current ();
+  if (cur->dl_runtime == 0
+      || t->dl_start + t->dl_deadline < cur->dl_start + cur->dl_deadline)
+    intr_yield_on_return ();
+}
+
+/* Gives the running thread a reservation of RUNTIME timer ticks
+   in every PERIOD ticks, to be used within DEADLINE ticks of the
+   start of each period, which is now for the first.  While it
+   has budget left it runs ahead of all threads without a
+   reservation and of those with a later deadline; once it runs
+   out it is kept off the run queues until its next period.  A
+   RUNTIME of 0 drops the reservation.
+
+   Returns false, changing nothing, unless RUNTIME <= DEADLINE <=
+   PERIOD, if the reservations together would take more than
+   EDF_MAX_UTIL per mille of the CPU, or if the clock is not
+   calibrated yet. */
+bool
+thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int util = 0;
+
+  if (runtime < 0 || (runtime > 0 && (runtime > deadline || deadline > period)))
+    return false;
+  if (runtime > 0)
+    {
+      if (edf_tick_cycles () == 0)
+        return false;
+      util = DIV_ROUND_UP (runtime * 1000, period);
+    }
+
+  old_level = intr_disable ();
+  if (edf_util - cur->dl_util + util > EDF_MAX_UTIL)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  edf_util += util - cur->dl_util;
+  cur->dl_util = util;
+  cur->dl_runtime = runtime;
+  cur->dl_deadline = deadline;
+  cur->dl_period = period;
+  cur->dl_start = timer_ticks ();
+  cur->dl_left = runtime * edf_tick_cycles ();
+  cur->dl_exec_start = clock_cycles ();
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Chooses and returns the next thread to be scheduled.  Returns
+   the highest priority thread from the run queues.  (If the
+   running thread can continue running, then it will be in a run
+   queue.)  If there is nothing to run, returns idle_thread. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  
-  if (list_empty (&ready_list))
+  struct thread *t = ready_pop ();
+
+  if (t == NULL)
     return idle_thread;
-  else
-    return list_entry (list_pop_back (&ready_list), struct thread, elem);
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -840,8 +1424,15 @@ thread_schedule_tail (struct thread *prev)
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
 
-  /* Start new time slice. */
+  /* Start new time slice.  The idle thread has none, so a
+     tickless timer can leave the CPU halted. */
   thread_ticks = 0;
+  if (cur->dl_runtime > 0)
+    time_slice = (cur->dl_left > 0
+                ? DIV_ROUND_UP (cur->dl_left, edf_tick_cycles ()) : 1);
+  else
+    time_slice = thread_cfs ? cfs_slice (cur) : TIME_SLICE;
+  timer_start_slice (cur != idle_thread ? time_slice : 0);
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -856,7 +1447,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_free (prev);
     }
 }
 
@@ -878,8 +1469,28 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  /* A yielding thread was charged before it was queued. */
+  if (cur->status != THREAD_READY && cur != idle_thread)
+    {
+      if (thread_cfs)
+        cfs_charge (cur);
+      if (cur->dl_runtime > 0)
+        edf_charge (cur);
+    }
+
+  /* Threads always switch in the kernel, so the outgoing
+     thread's time since its last charge is kernel time. */
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      uint64_t now = clock_cycles ();
+      cur->kernel_cycles += now - cur->cpu_mark;
+      next->cpu_mark = now;
+      next->exec_start = now;
+      next->dl_exec_start = now;
+
+      TRACE (TRACE_SWITCH, cur->tid, next->tid, next->priority);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -888,14 +1499,56 @@ static tid_t
 allocate_tid (void) 
 {
   static tid_t next_tid = 1;
-  tid_t tid;
-
-  lock_acquire (&tid_lock);
-  tid = next_tid++;
-  lock_release (&tid_lock);
+  tid_t tid = 1;
 
+  /* lock xadd is atomic across CPUs, so no lock is needed. */
+  asm volatile ("lock xaddl %0, %1" : "+r" (tid), "+m" (next_tid) : : "memory");
   return tid;
 }
+
+/* Returns a page for a new thread, or a null pointer if memory
+   is out.  Pages of exited threads are reused first, which saves
+   the page allocator's lock and setting up the page again, see
+   init_thread_page().  The page is not zeroed: the stack above
+   the struct thread needs no clearing. */
+static struct thread *
+thread_page_alloc (void) 
+{
+  struct thread *t = NULL;
+  enum intr_level old_level = intr_disable ();
+
+  if (thread_cache_cnt > 0)
+    t = thread_cache[--thread_cache_cnt];
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    {
+      t = palloc_get_page (0);
+      if (t != NULL)
+        init_thread_page (t);
+    }
+  return t;
+}
+
+/* Frees the page of exited thread T, keeping it for a new thread
+   if the cache has room.  Interrupts must be off.  The
+   magic is cleared first, so a stale pointer to T fails
+   is_thread() even while the page sits in the cache. */
+static void
+thread_page_free (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (heap_empty (&t->locks));
+#ifdef VM
+  ASSERT (list_empty (&t->pinned_frames));
+#endif
+
+  t->magic = 0;
+  if (thread_cache_cnt < THREAD_CACHE_SIZE)
+    thread_cache[thread_cache_cnt++] = t;
+  else
+    palloc_free_page (t);
+}
 
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
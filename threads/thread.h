@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <hash.h>
+#include <procstat.h>
 #include "threads/synch.h"
 #include "userprog/syscall.h"
 #include <stdint.h>
@@ -101,13 +102,16 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
     /* Alarm Clok implementation. */
-    int64_t time_sleeping;              /* Sleeping time for the thread. */
+    int64_t time_sleeping;              /* Timer time to wake up at. */
 
     /* Synchonization variables */
+    struct heap_elem wait_elem;         /* Element in a semaphore's waiter heap. */
+    struct heap *wait_heap;             /* Heap wait_elem is queued in, or NULL. */
+    struct heap_elem *cond_elem;        /* Element in a condition's waiter heap, or NULL. */
+    struct heap *cond_heap;             /* Heap cond_elem is queued in. */
     struct lock *waiting; 
     struct thread *lock_holder;
-    struct list locks; 
-    struct list donations; 
+    struct heap locks;                  /* Held locks, keyed by their max_priority. */
     int original_priority;
 
     /* Process variables */
@@ -124,8 +128,9 @@ struct thread
     struct lock wait_lock;
     struct condition wait_cond; 
    /* Used in syscall open. */
-   int fd_next;                             /* ID of fiel descriptor*/
-   struct list files;
+   struct open_file **fd_table;             /* Open files indexed by fd, NULL for a free slot. */
+   struct bitmap *fd_map;                   /* Used fd slots, to hand out the lowest free fd. */
+   size_t fd_cap;                           /* Number of slots in fd_table. */
    int fd_exec;
 #endif
    /*VM Variables*/
@@ -133,9 +138,10 @@ struct thread
    struct hash sup_table; 
    struct hash mm_table;
    void *esp; 
-   void *fault_addr;
    bool on_syscall; 
    int mapid;
+   struct list pinned_frames;               /* Frames pinned by pin_page(). */
+   int evicting;                            /* Own pages evict_frame() is swapping out. */
 #endif
 
 
@@ -144,22 +150,33 @@ struct thread
     uint32_t *pagedir;                  /* Page directory. */
 #endif
 
+    /* Resource accounting, see thread_get_stats(). */
+    struct procstat stats;              /* Counters kept by their subsystems. */
+    uint64_t user_cycles;               /* CPU time in user mode. */
+    uint64_t kernel_cycles;             /* CPU time in the kernel. */
+    uint64_t cpu_mark;                  /* Start of the CPU time not charged yet. */
+
     /* Owned by thread.c. */
     int nice;                           /* Nice*/
     int recent_cpu;                     /* Recent CPU*/
+    uint64_t vruntime;                  /* Weighted cycles run, for -cfs. */
+    uint64_t exec_start;                /* Cycles when vruntime was last charged. */
+    struct heap_elem run_elem;          /* Element in a cfs_queue or edf_queue. */
+    int64_t dl_runtime;                 /* Budget per period in ticks, 0 if no reservation. */
+    int64_t dl_deadline;                /* Deadline, in ticks from the period's start. */
+    int64_t dl_period;                  /* Period, in ticks. */
+    int64_t dl_start;                   /* Start of the current period, in timer ticks. */
+    int64_t dl_left;                    /* Budget left in the current period, in cycles. */
+    uint64_t dl_exec_start;             /* Cycles when dl_left was last charged. */
+    int dl_util;                        /* Per mille of the CPU reserved. */
     unsigned magic;                     /* Detects stack overflow. */
   };
 
   struct open_file{
     int fd;                             /* File descriptor ID. */
-    char* name;                         /* File's name. */
     struct file *tfiles;                /* Pointer to the file the file descriptor is pointing to. */
-    struct list_elem at;                /* List element to add the file to the thread's file list. */
-    struct list_elem af;                /* List element to add the file to a list with all the files. */
   };
 
-  struct list all_files;                /* List with all the files. */
-
 #ifdef VM
 struct mmap_file{
    mapid_t mapping; 
@@ -178,17 +195,28 @@ struct mmap_file{
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_tick_oneshot (int64_t elapsed, bool slice_over);
 void thread_print_stats (void);
+void thread_charge_user (void);
+void thread_charge_kernel (void);
+void thread_get_stats (struct thread *, struct procstat *);
+int thread_get_all_stats (struct procstat *, int max);
+uint64_t thread_idle_cycles (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+bool thread_preempts (struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -196,14 +224,16 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
-void insert_in_waiting_list(int64_t ticks);
-void remover_thread_durmiente(int64_t ticks);
+void insert_in_waiting_list(int64_t wake);
+void remover_thread_durmiente(int64_t now);
+int64_t thread_next_wakeup (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
 void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
+bool thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period);
 void thread_set_priority (int);
 struct thread *get_thread(tid_t tid);
 
@@ -0,0 +1,131 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Size of the ring buffer, in pages. */
+#define TRACE_PAGES 16
+
+/* One trace record, 24 bytes. */
+struct trace_rec
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    uint16_t event;             /* enum trace_event. */
+    uint16_t tid;               /* Running thread. */
+    uint32_t arg[3];            /* Event arguments. */
+  };
+
+#define TRACE_RECS (TRACE_PAGES * PGSIZE / sizeof (struct trace_rec))
+
+/* Event names for -trace. */
+static const char *trace_names[TRACE_EVENT_CNT] =
+  {
+    "switch", "wakeup", "fault", "evict", "swapin", "swapout",
+    "syscall", "bread", "bwrite",
+  };
+
+uint32_t trace_mask;
+
+static uint32_t requested_mask; /* Events given with -trace. */
+static struct trace_rec *ring;  /* Ring buffer. */
+static uint64_t rec_cnt;        /* Records ever written. */
+
+/* Selects the events to trace from EVENTS, a comma-separated
+   list of event names, or "all".  Tracing starts at
+   trace_init(). */
+void
+trace_configure (const char *events)
+{
+  char buf[128];
+  char *name, *save_ptr;
+
+  if (events == NULL)
+    events = "all";
+  strlcpy (buf, events, sizeof buf);
+  for (name = strtok_r (buf, ",", &save_ptr); name != NULL;
+       name = strtok_r (NULL, ",", &save_ptr))
+    {
+      int i;
+
+      if (!strcmp (name, "all"))
+        {
+          requested_mask = (1u << TRACE_EVENT_CNT) - 1;
+          continue;
+        }
+      for (i = 0; i < TRACE_EVENT_CNT; i++)
+        if (!strcmp (name, trace_names[i]))
+          break;
+      if (i == TRACE_EVENT_CNT)
+        PANIC ("unknown trace event `%s'", name);
+      requested_mask |= 1u << i;
+    }
+}
+
+/* Allocates the ring buffer and enables the events selected
+   with trace_configure().  Must be called after palloc_init(). */
+void
+trace_init (void)
+{
+  if (requested_mask == 0)
+    return;
+  ring = palloc_get_multiple (PAL_ZERO, TRACE_PAGES);
+  if (ring == NULL)
+    {
+      printf ("trace: no memory for the ring buffer, tracing disabled\n");
+      return;
+    }
+  trace_mask = requested_mask;
+}
+
+/* Appends a record of EVENT with arguments A, B, C.  Use the
+   TRACE macro instead, which checks trace_mask first. */
+void
+trace_record (enum trace_event event, uint32_t a, uint32_t b, uint32_t c)
+{
+  enum intr_level old_level = intr_disable ();
+  struct trace_rec *r = &ring[rec_cnt++ % TRACE_RECS];
+  struct thread *t;
+  uint8_t *esp;
+
+  /* Like running_thread(), thread_current() asserts the thread is
+     running, which is not true inside schedule(). */
+  asm ("mov %%esp, %0" : "=g" (esp));
+  t = pg_round_down (esp);
+
+  r->tsc = clock_cycles ();
+  r->event = event;
+  r->tid = t->tid;
+  r->arg[0] = a;
+  r->arg[1] = b;
+  r->arg[2] = c;
+  intr_set_level (old_level);
+}
+
+/* Stops tracing and prints the records in the ring buffer,
+   oldest first. */
+void
+trace_print_stats (void)
+{
+  uint64_t first, i;
+
+  if (ring == NULL)
+    return;
+  trace_mask = 0;
+
+  first = rec_cnt > TRACE_RECS ? rec_cnt - TRACE_RECS : 0;
+  printf ("Trace: %"PRIu64" records, %"PRIu64" overwritten.\n",
+          rec_cnt - first, first);
+  for (i = first; i < rec_cnt; i++)
+    {
+      const struct trace_rec *r = &ring[i % TRACE_RECS];
+      printf ("TRC %016"PRIx64" %04"PRIx16" %04"PRIx16" %08"PRIx32
+              " %08"PRIx32" %08"PRIx32"\n", r->tsc, r->event, r->tid,
+              r->arg[0], r->arg[1], r->arg[2]);
+    }
+}
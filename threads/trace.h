@@ -0,0 +1,50 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+/* Static tracepoints.
+
+   TRACE (EVENT, A, B, C) appends a record with the time-stamp
+   counter, the running thread's tid, the event and three 32-bit
+   arguments to a ring buffer, if EVENT is enabled.  A disabled
+   tracepoint costs one test and branch.
+
+   Events are enabled with the -trace=EVENT,... kernel option, or
+   -trace=all.  The buffer is printed at shutdown as "TRC" lines,
+   which utils/pintos-trace turns into a timeline. */
+
+#include <stdint.h>
+
+/* Trace events.  Keep in sync with trace_names in trace.c and
+   with utils/pintos-trace. */
+enum trace_event
+  {
+    TRACE_SWITCH,               /* schedule(): prev tid, next tid, next priority. */
+    TRACE_WAKEUP,               /* thread_unblock(): tid, priority. */
+    TRACE_PAGE_FAULT,           /* page_fault(): address, eip, error code. */
+    TRACE_EVICT,                /* evict_frame(): kernel page, user page, owner tid. */
+    TRACE_SWAP_IN,              /* swap_read(): first sector, kernel page. */
+    TRACE_SWAP_OUT,             /* swap_write(): first sector, kernel page. */
+    TRACE_SYSCALL,              /* syscall_handler(): number, first argument. */
+    TRACE_BLOCK_READ,           /* block_read(): block type, sector. */
+    TRACE_BLOCK_WRITE,          /* block_write(): block type, sector. */
+    TRACE_EVENT_CNT
+  };
+
+/* Bit N is set if event N is enabled. */
+extern uint32_t trace_mask;
+
+#define TRACE(EVENT, A, B, C)                                           \
+        do                                                              \
+          {                                                             \
+            if (__builtin_expect (trace_mask & (1u << (EVENT)), 0))     \
+              trace_record ((EVENT), (uint32_t) (A), (uint32_t) (B),    \
+                            (uint32_t) (C));                            \
+          }                                                             \
+        while (0)
+
+void trace_configure (const char *events);
+void trace_init (void);
+void trace_record (enum trace_event, uint32_t a, uint32_t b, uint32_t c);
+void trace_print_stats (void);
+
+#endif /* threads/trace.h */
@@ -5,18 +5,21 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
 #include "userprog/pagedir.h"
 
 #include "vm/spage.h"
 #include "vm/frame.h"
+#include "vm/share.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static bool in_usercopy (const struct intr_frame *);
 
 
 /* Registers handlers for interrupts that can be caused by user
@@ -147,13 +150,13 @@ page_fault (struct intr_frame *f)
   /* Turn interrupts back on (they were only off so that we could
      be assured of reading CR2 before it changed). */
 #ifdef VM
-   uint64_t ticks = timer_ticks();
+   uint64_t now = clock_cycles();
    for (struct list_elem *iter = list_begin(&frame_table); iter != list_end(&frame_table); iter = list_next(iter))
    {
      struct frame_entry *frame = list_entry(iter, struct frame_entry, elem);
      if (pagedir_is_accessed(frame->owner->pagedir, frame->upage))
      {
-       frame->accessed_time = ticks;
+       frame->accessed_time = now;
        pagedir_set_accessed(frame->owner->pagedir, frame->upage, false);
      }
    }   
@@ -166,22 +169,35 @@ page_fault (struct intr_frame *f)
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
+  TRACE (TRACE_PAGE_FAULT, fault_addr, f->eip, f->error_code);
 #ifdef VM
-  fault_addr = (cur->on_syscall) ? cur->fault_addr : fault_addr;
+   /* Faults that end up reading a file or swap count themselves as major. */
+   uint32_t major_faults = cur->stats.major_faults;
+
+   /* First write to a copy-on-write executable page, kernel writes included. */
+   if (!not_present && write && is_user_vaddr(fault_addr))
+   {
+      struct spage_entry *cow_page = lookup_page(cur, pg_round_down(fault_addr));
+      if (cow_page != NULL && cow_page->cow && share_break_cow(cow_page))
+      {
+         cur->stats.minor_faults++;
+         return;
+      }
+   }
   void *esp = (cur->on_syscall) ? cur->esp : f->esp;
 #endif
    /* Write to ReadOnly page. */ 
    if (!not_present)
-      exit(-1); 
+      goto bad_access; 
 
    /* fault address is NULL */
    if (fault_addr == NULL){
-      exit(-1);
+      goto bad_access;
    }
 
    /* fault address is from kernel address space. */
    if(!is_user_vaddr(fault_addr)){
-      exit(-1);
+      goto bad_access;
    }
 
 bool vm = false;
@@ -191,6 +207,8 @@ bool vm = false;
 
    if (!vm)
    {
+      if (!user && in_usercopy(f))
+         goto bad_access;
       printf ("Page fault at %p: %s error %s page in %s context.\n",
                fault_addr,
                not_present ? "not present" : "rights violation",
@@ -208,19 +226,24 @@ bool vm = false;
       case MMFILE:
       case EXECUTABLE:
          load_file_page(page);
+         if (cur->stats.major_faults == major_faults)
+            cur->stats.minor_faults++;
          return;
       case PAGE:
          load_page(page);
+         if (cur->stats.major_faults == major_faults)
+            cur->stats.minor_faults++;
          break;
       }
    }else if (page == NULL && (esp - 32)  <= fault_addr && (void*)(PHYS_BASE - fault_addr) <= (void*)0x80408000){
       stack_growth(fault_addr);
+      cur->stats.minor_faults++;
    }else{
       /*
          If a USER fault address got to this point, means this access was trying to access the stack but failed to pass the growth stack assertions. 
       // */
       if (is_user_vaddr(fault_addr)){
-         exit(-1);    
+         goto bad_access;    
       }
       
       
@@ -236,6 +259,26 @@ bool vm = false;
       kill (f);
    }
 #endif
+   return;
+
+bad_access:
+   /* A failed get_user()/put_user() resumes after the access with -1 in eax. */
+   if (!user && in_usercopy(f))
+   {
+      f->eip = (void (*) (void)) f->eax;
+      f->eax = 0xffffffff;
+      return;
+   }
+   exit(-1);
+}
+
+/* Returns true if the faulting instruction is one of the user memory accessors 
+   in syscall.c, which are linked between _start_usercopy and _end_usercopy. */
+static bool
+in_usercopy (const struct intr_frame *f)
+{
+   extern char _start_usercopy[], _end_usercopy[];
+   return (char*) f->eip >= _start_usercopy && (char*) f->eip < _end_usercopy;
 }
 
 #ifdef VM
@@ -244,12 +287,14 @@ bool stack_growth(void *fault_address)
    void *upage = pg_round_down(fault_address); 
    uint32_t* frame = create_frame(); 
    if (frame != NULL){
+      /* The page entry goes in first so install_frame() can link it to its frame. */
+      get_page(upage, true); 
       bool success = install_frame(frame, upage, true); 
       if (!success){
+         remove_SPentry(&thread_current()->sup_table, upage);
          destroy_frame(frame);
          return false;
       }
-      get_page(upage, true); 
       
       return true;
    }else 
@@ -28,6 +28,7 @@
 #include "vm/spage.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/share.h"
 #endif
 
 static thread_func start_process NO_RETURN;
@@ -278,18 +279,11 @@ process_exit (void)
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
 
+  /* Killed processes never went through exit(), close what they left open. */
+  close_all_files();
+
   #ifdef VM
-  for (struct list_elem *iter = list_begin(&frame_table); iter != list_end(&frame_table); )
-  {
-    struct frame_entry *fte = list_entry(iter, struct frame_entry, elem); 
-    if (cur == fte->owner){
-      iter = list_next(iter); 
-      list_remove(&fte->elem); 
-      free(fte);
-    }else 
-      iter = list_next(iter);
-    
-  }
+  frame_exit(cur);
 
   hash_destroy(&cur->sup_table, sptable_destroy); 
   hash_destroy(&cur->mm_table, mmtable_destroy); 
@@ -431,15 +425,15 @@ load (const char *file_name, void (**eip) (void), void **esp)
       printf ("load: %s: open failed\n", t->name);
       goto done;
     }
-  /* create open file struct and push it to thread files and all files list */
-  struct open_file *op_file = malloc(sizeof(struct open_file));
+  /* Keep the executable open in the fd table until the process exits. */
   file_deny_write(file);
-  op_file->fd = t->fd_next++;
-  op_file->tfiles = file;
-  op_file->name = t->name;
-  list_push_back(&t->files, &op_file->at);
-  list_push_back(&all_files, &op_file->af);
-  t->fd_exec = op_file->fd;
+  t->fd_exec = add_file(file);
+  if (t->fd_exec == -1)
+    {
+      file_close (file);
+      file = NULL;
+      goto done;
+    }
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
@@ -529,7 +523,8 @@ load (const char *file_name, void (**eip) (void), void **esp)
     else it stays open until process exits.
   */
   if (!success && file != NULL){
-    close(op_file->fd);
+    close(t->fd_exec);
+    t->fd_exec = -1;
   }
 
   return success;
@@ -669,6 +664,10 @@ setup_stack (void **esp, char *args, char *name)
   
   if (kpage != NULL)
   {
+    #ifdef VM
+    /* The page entry goes in first so install_frame() can link it to its frame. */
+    get_page(((uint8_t*)PHYS_BASE - PGSIZE), true);
+    #endif
     if (vm_flag)
       success = install_frame(kpage, ((uint8_t*)PHYS_BASE) - PGSIZE , true );
     else 
@@ -676,9 +675,6 @@ setup_stack (void **esp, char *args, char *name)
 
     if (success)
     { 
-      #ifdef VM
-      get_page(((uint8_t*)PHYS_BASE - PGSIZE), true);
-      #endif
 
       *esp = PHYS_BASE;
       /* SETUP args in stack*/
@@ -753,8 +749,11 @@ install_page (void *upage, void *kpage, bool writable)
 
   /* Verify that there's not already a page at that virtual
      address, then map our page there. */
-  return (pagedir_get_page (t->pagedir, upage) == NULL
-          && pagedir_set_page (t->pagedir, upage, kpage, writable));
+  if (pagedir_get_page (t->pagedir, upage) != NULL
+      || !pagedir_set_page (t->pagedir, upage, kpage, writable))
+    return false;
+  t->stats.frames++;
+  return true;
 }
 
 /* Take the args string and reverse de agrs order. 
@@ -2,11 +2,14 @@
 #include "userprog/process.h"
 #include "userprog/syscall.h"
 #include "userprog/exception.h"
+#include "userprog/tss.h"
 
 #include "lib/kernel/stdio.h"
 #include "lib/string.h"
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <iovec.h>
+#include <limits.h>
 
 #include "threads/malloc.h"
 #include "threads/interrupt.h"
@@ -14,9 +17,12 @@
 #include "devices/shutdown.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/palloc.h"
+#include "threads/trace.h"
 
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include <bitmap.h>
 
 #include "devices/timer.h"
 #include "devices/input.h"
@@ -29,16 +35,112 @@
 #define STDIN_FILENO 0
 #define STDOUT_FILENO 1
 
-static void syscall_handler (struct intr_frame *);
-static bool verify_pointer(void *pointer); 
+/* Size of the kernel copy of a file name argument. Longer names cannot exist. */
+#define FILE_NAME_BUF 64
+
+/* Places a function in the section the page fault handler recovers user access faults in. */
+#define USERCOPY __attribute__ ((section (".text.usercopy"), noinline))
+
+/* Initial number of slots in a process's file descriptor table. */
+#define FD_TABLE_INIT 16
+
+/* Most arguments a system call takes. */
+#define SYSCALL_MAX_ARGS 4
+
+/* Most bytes transfer() checks or pins and moves at once. */
+#define TRANSFER_CHUNK (16 * PGSIZE)
+
+/* Kinds of system call arguments, which say how syscall_handler() checks them before the 
+   handler runs. */
+enum arg_kind
+  {
+    ARG_INT,                    /* Any value, passed on as is. */
+    ARG_FD,                     /* File descriptor that must be open, else the process exits. */
+    ARG_PTR,                    /* User address the handler checks itself. */
+    ARG_NAME,                   /* File name, copied into a FILE_NAME_BUF buffer. */
+    ARG_CMDLINE,                /* Command line, copied into a page. */
+    ARG_BUF_IN,                 /* User buffer the kernel reads, size in the next argument. */
+    ARG_BUF_OUT                 /* User buffer the kernel writes, size in the next argument. */
+  };
+
+/* A system call handler. ARGS holds the arguments, with strings already copied into 
+   kernel memory. Returns the value for eax. */
+typedef uint32_t syscall_func (const uint32_t *args);
+
+/* How to run a system call. */
+struct syscall
+  {
+    syscall_func *func;                         /* Handler, or null if not implemented. */
+    int argc;                                   /* Number of arguments. */
+    enum arg_kind kinds[SYSCALL_MAX_ARGS];      /* Kind of each argument. */
+    uint32_t error;                             /* Returned if a string does not fit. */
+  };
+
+static syscall_func sys_halt, sys_exit, sys_exec, sys_wait, sys_create, sys_remove, 
+  sys_open, sys_filesize, sys_read, sys_write, sys_seek, sys_tell, sys_close, 
+  sys_clock, sys_stats, sys_stats_all, sys_sched_deadline, sys_pread, sys_pwrite, 
+  sys_readv, sys_writev;
+#ifdef VM
+static syscall_func sys_mmap, sys_munmap;
+#endif
+
+/* System calls by number. */
+static const struct syscall syscalls[] =
+  {
+    [SYS_HALT] =            {sys_halt, 0, {}, 0},
+    [SYS_EXIT] =            {sys_exit, 1, {ARG_INT}, 0},
+    [SYS_EXEC] =            {sys_exec, 1, {ARG_CMDLINE}, TID_ERROR},
+    [SYS_WAIT] =            {sys_wait, 1, {ARG_INT}, 0},
+    [SYS_CREATE] =          {sys_create, 2, {ARG_NAME, ARG_INT}, false},
+    [SYS_REMOVE] =          {sys_remove, 1, {ARG_NAME}, false},
+    [SYS_OPEN] =            {sys_open, 1, {ARG_NAME}, -1},
+    [SYS_FILESIZE] =        {sys_filesize, 1, {ARG_FD}, 0},
+    [SYS_READ] =            {sys_read, 3, {ARG_INT, ARG_BUF_OUT, ARG_INT}, 0},
+    [SYS_WRITE] =           {sys_write, 3, {ARG_INT, ARG_BUF_IN, ARG_INT}, 0},
+    [SYS_SEEK] =            {sys_seek, 2, {ARG_FD, ARG_INT}, 0},
+    [SYS_TELL] =            {sys_tell, 1, {ARG_FD}, 0},
+    [SYS_CLOSE] =           {sys_close, 1, {ARG_INT}, 0},
+#ifdef VM
+    [SYS_MMAP] =            {sys_mmap, 2, {ARG_INT, ARG_PTR}, 0},
+    [SYS_MUNMAP] =          {sys_munmap, 1, {ARG_INT}, 0},
+#endif
+    [SYS_CLOCK] =           {sys_clock, 1, {ARG_PTR}, 0},
+    [SYS_STATS] =           {sys_stats, 2, {ARG_INT, ARG_PTR}, 0},
+    [SYS_STATS_ALL] =       {sys_stats_all, 2, {ARG_PTR, ARG_INT}, 0},
+    [SYS_SCHED_DEADLINE] =  {sys_sched_deadline, 3, {ARG_INT, ARG_INT, ARG_INT}, false},
+    [SYS_PREAD] =           {sys_pread, 4, {ARG_INT, ARG_BUF_OUT, ARG_INT, ARG_INT}, 0},
+    [SYS_PWRITE] =          {sys_pwrite, 4, {ARG_INT, ARG_BUF_IN, ARG_INT, ARG_INT}, 0},
+    [SYS_READV] =           {sys_readv, 3, {ARG_INT, ARG_PTR, ARG_INT}, 0},
+    [SYS_WRITEV] =          {sys_writev, 3, {ARG_INT, ARG_PTR, ARG_INT}, 0},
+  };
+
+/* Number of entries in syscalls[]. */
+#define SYSCALL_CNT ((int) (sizeof syscalls / sizeof *syscalls))
+
+/* Serializes every call into the file system. */
+struct lock file_system_lock;
+
+void syscall_handler (struct intr_frame *);
+void syscall_sysenter (void);
+static bool cpu_has_sysenter (void);
+static int get_arg(const int *args, int idx);
+static bool prepare_args(const struct syscall *sc, uint32_t *args, char *name, char **page);
+static bool copy_in_string(char *dst, const char *usrc, size_t size);
+static int fetch_string(char *dst, const char *usrc, size_t size);
+static void copy_in(void *dst, const void *usrc, size_t size);
+static int transfer(int fd, const struct iovec *iov, int iovcnt, off_t ofs, bool write);
+static void copy_out(void *udst, const void *src, size_t size);
+#ifndef VM
+static void check_buffer(void *buffer, unsigned size, bool write);
+#endif
+static bool grow_fd_table(struct thread *t);
 void delete_children(struct hash_elem *elem, void *aux);
 
 void delete_parent_from_child(struct hash_elem *elem, void *aux);
 void print_children(struct hash_elem *elem, void *aux);
 
 #ifdef VM
-static void  preload(void *buffer, size_t size); 
-int calc_pages(void *upage, size_t size);
+static void pin_buffer(const void *buffer, size_t size, bool write); 
 #endif
 
 
@@ -57,246 +159,496 @@ void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  if (cpu_has_sysenter())
+    tss_enable_sysenter(syscall_sysenter);
   lock_init(&file_system_lock);
   
 }
 
+/*
+  Returns true if the CPU has the sysenter and sysexit instructions. User programs make
+  the same check (see lib/user/entry.c) and use int $0x30 without them.
+*/
+static bool
+cpu_has_sysenter(void)
+{
+  uint32_t eax, ebx, ecx, edx;
+
+  asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  return (edx & (1 << 11)) != 0;
+}
+
 
 /*
   Handles the syscalls, the input is an interrupt frame that contains the stack. 
-  The intr_frame contains the SYS_CODE and up to three SYSCALL arguments.  
+  The intr_frame contains the SYS_CODE and up to four SYSCALL arguments.  
 
   f->esp = SYS_CODE;
   f->esp + 1 = arg1;
   f->esp + 2 = arg2; 
   f->esp + 3 = arg3; 
+  f->esp + 4 = arg4; 
+
+  The system call is looked up in syscalls[], which says how many arguments it takes 
+  and of what kind. Arguments are fetched with get_arg(), a plain load from the user 
+  stack. If the address is bad the page fault handler makes the load fail and the 
+  process exits. prepare_args() then copies strings into kernel memory and checks 
+  buffers, all before the handler runs, so handlers see only checked arguments. 
+  Unknown system calls return -1.
 
-  Each argument is a pointer, so before  using its value the fuctions has to dereference the pointer. 
+  Called through int $0x30, or from syscall_sysenter (syscall-entry.S), whose frame
+  has only the user registers a system call looks at.
   
-  ** SEE SYS_EXIT for an example.** 
+  ** SEE sys_exit() for an example.** 
 
 */
 void
-syscall_handler (struct intr_frame *f UNUSED) 
+syscall_handler (struct intr_frame *f) 
 {
   struct thread *cur = thread_current(); 
-  int status;
-  char* cmd_name;
-  int tid;
-  char* file_name;
-  
-  int fd;
-  unsigned position;
-  unsigned size;
-  void* buffer;
+  const int *uargs = f->esp;
+  const struct syscall *sc = NULL;
+  uint32_t args[SYSCALL_MAX_ARGS];
+  char name[FILE_NAME_BUF];
+  char *page = NULL;
+  int number, i;
 
-  if (!verify_pointer(f->esp))
-  {
-    exit(-1);
-  }
 #ifdef VM
   cur->esp = f->esp;
   cur->on_syscall = true;
 #endif
 
-  switch (*(int*)f->esp){
-    case SYS_HALT:
-      shutdown_power_off();
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_EXIT:
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
-      status = *((int*)f->esp + 1);
-      
-      exit(status);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_EXEC:
-      cmd_name = (char*)(*((int*)f->esp + 1)); 
-      if (!verify_pointer(cmd_name))
-        exit(-1);
-
-      f->eax = exec(cmd_name);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_WAIT:
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
-      
-      tid = *((int*)f->esp + 1); 
-      f->eax = process_wait(tid);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_READ:
-      if (!verify_pointer((int*)f->esp + 1)){
-        exit(-1);
-      }
+  number = get_arg(uargs, 0);
+  if (number >= 0 && number < SYSCALL_CNT && syscalls[number].func != NULL)
+    sc = &syscalls[number];
+  for (i = 0; sc != NULL && i < sc->argc; i++)
+    args[i] = get_arg(uargs, i + 1);
+  TRACE(TRACE_SYSCALL, number, sc != NULL && sc->argc > 0 ? args[0] : 0, 0);
 
-      if (!verify_pointer((int*)f->esp + 3)){
-        exit(-1);
-      }
+  if (sc == NULL)
+    f->eax = -1;
+  else
+  {
+    if (number < PROCSTAT_SYSCALL_CNT)
+      cur->stats.syscalls[number]++;
+    if (prepare_args(sc, args, name, &page))
+      f->eax = sc->func(args);
+    else
+      f->eax = sc->error;
+    if (page != NULL)
+      palloc_free_page(page);
+  }
 
-      
+#ifdef VM
+  cur->on_syscall = false; 
+  cur->esp = NULL; 
+#endif
+}
 
-      fd = (*((int*)f->esp + 1)); 
-      buffer = (char*)(*((int*)f->esp + 2));
-      size = (*((int*)f->esp + 3));
+/*
+  Checks the arguments in ARGS of system call SC and puts kernel copies of strings in 
+  their place: a file name goes into NAME, which has FILE_NAME_BUF bytes, and a command 
+  line into a new page stored in *PAGE for the caller to free. Exits the process if a 
+  pointer is bad. Returns false if a string does not fit or memory is out.
+*/
+static bool
+prepare_args(const struct syscall *sc, uint32_t *args, char *name, char **page)
+{
+  int i, r;
+
+  for (i = 0; i < sc->argc; i++)
+    switch (sc->kinds[i])
+    {
+      case ARG_INT:
+      case ARG_PTR:
+        break;
+
+      case ARG_FD:
+        if (get_file(args[i]) == NULL)
+          exit(-1);
+        break;
+
+      case ARG_NAME:
+        if (!copy_in_string(name, (const char*) args[i], FILE_NAME_BUF))
+          return false;
+        args[i] = (uint32_t) name;
+        break;
+
+      case ARG_CMDLINE:
+        *page = palloc_get_page(0);
+        if (*page == NULL)
+          return false;
+        /* Free the page before exiting, nobody else will. */
+        r = fetch_string(*page, (const char*) args[i], PGSIZE);
+        if (r < 0){
+          palloc_free_page(*page);
+          *page = NULL;
+          exit(-1);
+        }
+        if (r == 0)
+          return false;
+        args[i] = (uint32_t) *page;
+        break;
+
+      case ARG_BUF_IN:
+      case ARG_BUF_OUT:
+        if (args[i] == 0 || !is_user_vaddr((void*) args[i]))
+          exit(-1);
+        /* The last byte must be a user address too, and must not wrap around. */
+        if (args[i + 1] != 0 
+            && (args[i] + args[i + 1] - 1 < args[i] || !is_user_vaddr((void*) (args[i] + args[i + 1] - 1))))
+          exit(-1);
+#ifndef VM
+        check_buffer((void*) args[i], args[i + 1], sc->kinds[i] == ARG_BUF_OUT);
+#endif
+        break;
+    }
+  return true;
+}
 
-      if (!is_user_vaddr(buffer) || buffer == NULL){
-        exit(-1);
-      }
-      
-      f->eax = read(fd, buffer, size);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_REMOVE:
-      file_name = (char*)(*((int*)f->esp + 1)); 
-      if (!verify_pointer(file_name))
-        exit(-1);
-      
-      f->eax = remove(file_name);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_OPEN:
-      file_name = (void*)(*((int*)f->esp + 1)); 
-      if (!verify_pointer(file_name)){
-        exit(-1);
-      }
-      
-      f->eax = open(file_name);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_FILESIZE:
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
-      
-      fd = (*((int*)f->esp + 1)); 
-      f->eax = filesize(fd);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_CREATE: 
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
-      
-      if (!verify_pointer((int*)f->esp + 2))
-        exit(-1);
-      
-      file_name = (char*)(*((int*)f->esp + 1)); 
-      if (!verify_pointer(file_name))
-        exit(-1);
-
-      size = (*((int*)f->esp + 2));
-      f->eax = create(file_name, size);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_WRITE:
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
-
-      if (!verify_pointer((int*)f->esp + 3))
-        exit(-1);
-
-      fd = *((int*)f->esp + 1);
-      buffer = (void*)(*((int*)f->esp + 2));
-      size = *((int*)f->esp + 3);
-
-      if (!verify_pointer(buffer))
-        exit(-1);
-      f->eax = write(fd, buffer, size);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_SEEK:
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
-      
-      if (!verify_pointer((int*)f->esp + 2))
-        exit(-1);
-          
-      fd = *((int*)f->esp + 1);
-      position = *((int*)f->esp + 2);
-
-      seek(fd, position);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_TELL:
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
-
-      fd = *((int*)f->esp + 1);
-
-      f->eax = tell(fd);
-      break;
-
-    // *************************************************************************************************************************************************
-    case SYS_CLOSE:
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
-      
-      fd = *((int*)f->esp + 1); 
-      close(fd);
-      break;
-#ifdef VM
-    case SYS_MMAP: 
-      if (!verify_pointer((int*)f->esp + 1))
-        exit(-1);
+// *************************************************************************************************************************************************
+static uint32_t
+sys_halt(const uint32_t *args UNUSED)
+{
+  shutdown_power_off();
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_exit(const uint32_t *args)
+{
+  exit(args[0]);
+  NOT_REACHED();
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_exec(const uint32_t *args)
+{
+  return exec((const char*) args[0]);
+}
 
-      buffer = (void*)(*((int*)f->esp + 2));
+// *************************************************************************************************************************************************
+static uint32_t
+sys_wait(const uint32_t *args)
+{
+  return process_wait(args[0]);
+}
 
-      fd = *((int*)f->esp + 1);
-      buffer = (void*)(*((int*)f->esp + 2));
+// *************************************************************************************************************************************************
+static uint32_t
+sys_create(const uint32_t *args)
+{
+  return create((const char*) args[0], args[1]);
+}
 
-      f->eax = mmap(fd, buffer);
-      break;
-    case SYS_MUNMAP:
-      if (!verify_pointer((int*)f->esp + 1))
-          exit(-1);  
+// *************************************************************************************************************************************************
+static uint32_t
+sys_remove(const uint32_t *args)
+{
+  return remove((const char*) args[0]);
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_open(const uint32_t *args)
+{
+  return open((const char*) args[0]);
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_filesize(const uint32_t *args)
+{
+  return filesize(args[0]);
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_read(const uint32_t *args)
+{
+  int n = read(args[0], (char*) args[1], args[2]);
+  if (n > 0)
+    thread_current()->stats.bytes_read += n;
+  return n;
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_write(const uint32_t *args)
+{
+  int n = write(args[0], (void*) args[1], args[2]);
+  if (n > 0)
+    thread_current()->stats.bytes_written += n;
+  return n;
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_seek(const uint32_t *args)
+{
+  seek(args[0], args[1]);
+  return 0;
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_tell(const uint32_t *args)
+{
+  return tell(args[0]);
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_close(const uint32_t *args)
+{
+  close(args[0]);
+  return 0;
+}
 
-      fd = *((int*)f->esp + 1);
-      unmap((mapid_t)fd);
-      break;
-#endif
-  }
 #ifdef VM
-  cur->on_syscall = false; 
-  cur->esp = NULL; 
-  cur->fault_addr = NULL;
+// *************************************************************************************************************************************************
+static uint32_t
+sys_mmap(const uint32_t *args)
+{
+  return mmap(args[0], (void*) args[1]);
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_munmap(const uint32_t *args)
+{
+  unmap(args[0]);
+  return 0;
+}
 #endif
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_clock(const uint32_t *args)
+{
+  uint64_t ns = clock_ns();
+  copy_out((void*) args[0], &ns, sizeof ns);
+  return 0;
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_stats(const uint32_t *args)
+{
+  return stats(args[0], (struct procstat*) args[1]);
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_stats_all(const uint32_t *args)
+{
+  return stats_all((struct procstat*) args[0], args[1]);
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_sched_deadline(const uint32_t *args)
+{
+  return sched_deadline(args[0], args[1], args[2]);
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_pread(const uint32_t *args)
+{
+  int n = pread(args[0], (void*) args[1], args[2], args[3]);
+  if (n > 0)
+    thread_current()->stats.bytes_read += n;
+  return n;
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_pwrite(const uint32_t *args)
+{
+  int n = pwrite(args[0], (const void*) args[1], args[2], args[3]);
+  if (n > 0)
+    thread_current()->stats.bytes_written += n;
+  return n;
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_readv(const uint32_t *args)
+{
+  int n = readv(args[0], (const struct iovec*) args[1], args[2]);
+  if (n > 0)
+    thread_current()->stats.bytes_read += n;
+  return n;
+}
+
+// *************************************************************************************************************************************************
+static uint32_t
+sys_writev(const uint32_t *args)
+{
+  int n = writev(args[0], (const struct iovec*) args[1], args[2]);
+  if (n > 0)
+    thread_current()->stats.bytes_written += n;
+  return n;
+}
+
+/*
+  User memory access. These routines touch user memory directly, without walking the 
+  page tables first. If the access faults on an invalid address, the page fault handler 
+  sees that the faulting instruction is in the .text.usercopy section, stores -1 in eax 
+  and resumes at the address that was in eax, which is the label right after the access. 
+  See page_fault() in exception.c.
+*/
+
+/* Reads a byte at user address UADDR, which must be below PHYS_BASE. 
+   Returns the byte value if successful, -1 if a fault occurred. */
+static int USERCOPY
+get_user (const uint8_t *uaddr)
+{
+  int result;
+  asm volatile ("movl $1f, %0; movzbl %1, %0; 1:"
+                : "=&a" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Writes BYTE to user address UDST, which must be below PHYS_BASE. 
+   Returns true if successful, false if a fault occurred. */
+static bool USERCOPY
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error_code;
+  asm volatile ("movl $1f, %0; movb %b2, %1; 1:"
+                : "=&a" (error_code), "=m" (*udst) : "q" (byte));
+  return error_code != -1;
+}
+
+/* Reads the 32-bit word at user address UADDR into *DST with a single load. 
+   Returns true if successful, false if a fault occurred. */
+static bool USERCOPY
+get_user_word (const uint32_t *uaddr, uint32_t *dst)
+{
+  int error_code;
+  uint32_t value;
+  asm volatile ("movl $1f, %0; movl %2, %1; 1:"
+                : "=&a" (error_code), "=&r" (value) : "m" (*uaddr));
+  if (error_code == -1)
+    return false;
+  *dst = value;
+  return true;
 }
 
+/* Returns syscall argument IDX from the user stack at ARGS. Exits the process if the 
+   argument is not in readable user memory. */
+static int 
+get_arg (const int *args, int idx)
+{
+  const int *arg = args + idx;
+  uint32_t value;
+
+  if ((const uint8_t*) (arg + 1) > (const uint8_t*) PHYS_BASE 
+      || !get_user_word ((const uint32_t*) arg, &value))
+    exit(-1);
+  return value;
+}
 
 /*
-  Checks if pointer meets this two conditions: 
-    1. Pointer is between PHYS_BASE and 0x08048000
-    2. The pointer is allocated in thread page.
+  Copies the user string USRC into the kernel buffer DST of SIZE bytes in one pass. 
+  Exits the process if USRC is not in readable user memory. Returns false if the 
+  string does not fit in DST, true otherwise.
+*/
+static bool 
+copy_in_string (char *dst, const char *usrc, size_t size)
+{
+  int r = fetch_string(dst, usrc, size);
+
+  if (r < 0)
+    exit(-1);
+  return r > 0;
+}
 
+/*
+  Like copy_in_string(), but leaves it to the caller to exit, so it can free what it 
+  holds first. Returns 1 if the string was copied, 0 if it does not fit in DST and -1 
+  if USRC is not in readable user memory.
 */
-bool 
-verify_pointer(void *pointer)
+static int 
+fetch_string (char *dst, const char *usrc, size_t size)
 {
-  struct thread *cur = thread_current(); 
-  bool valid = true;
+  size_t i;
 
-  if (!is_user_vaddr(pointer) || pointer == NULL)
-      return false;
-  
-  if (pagedir_get_page(cur->pagedir, pointer) == NULL)
-      return false;
-  
-  return valid; 
+  for (i = 0; i < size; i++)
+  {
+    int c;
+    if (!is_user_vaddr(usrc + i) || (c = get_user((const uint8_t*) usrc + i)) == -1)
+      return -1;
+    dst[i] = c;
+    if (c == '\0')
+      return 1;
+  }
+  return 0;
+}
+
+/*
+  Copies SIZE bytes from the user address USRC to the kernel buffer DST. Exits the 
+  process if USRC is not in readable user memory.
+*/
+static void 
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  uint8_t *d = dst;
+  const uint8_t *src = usrc;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+  {
+    int c;
+    if (!is_user_vaddr(src + i) || (c = get_user(src + i)) == -1)
+      exit(-1);
+    d[i] = c;
+  }
+}
+
+/*
+  Copies SIZE bytes from the kernel buffer SRC to the user address UDST. Exits the 
+  process if UDST is not in writable user memory.
+*/
+static void 
+copy_out (void *udst, const void *src, size_t size)
+{
+  uint8_t *dst = udst;
+  const uint8_t *s = src;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (!is_user_vaddr(dst + i) || !put_user(dst + i, s[i]))
+      exit(-1);
 }
 
+#ifndef VM
+/*
+  Touches one byte in every page of the user buffer BUFFER so the file system can copy 
+  straight into or out of it. If WRITE is true, the byte is written back to check that 
+  the page is writable. Exits the process if any page is invalid.
+*/
+static void 
+check_buffer (void *buffer, unsigned size, bool write)
+{
+  uint8_t *addr = buffer;
+  uint8_t *end = addr + size;
+
+  if (end < addr || !is_user_vaddr(end - (size > 0)))
+    exit(-1);
+  while (addr < end)
+  {
+    int c = get_user(addr);
+    if (c == -1 || (write && !put_user(addr, c)))
+      exit(-1);
+    addr = (uint8_t*) pg_round_down(addr) + PGSIZE;
+  }
+}
+#endif
+
 
 void 
 exit(int status)
@@ -324,22 +676,13 @@ exit(int status)
   hash_destroy(&cur->children, delete_children);
 
   struct lock *lock;
-  while (!list_empty(&cur->locks))
+  while (!heap_empty(&cur->locks))
   {
-    lock = list_entry(list_pop_back(&cur->locks), struct lock, elem);
+    lock = heap_entry(heap_top(&cur->locks), struct lock, elem);
     lock_release(lock);
   }
 
-  if (cur->fd_exec != -1)
-    close(cur->fd_exec);
-
-  struct list_elem *iter = list_begin(&cur->files); 
-  while (!list_empty(&cur->files))
-  {   
-    struct open_file *op_file = list_entry(iter, struct open_file, at);
-    iter = list_next(iter);
-    close(op_file->fd);
-  }
+  close_all_files();
 
   #ifdef VM  
   struct hash_iterator e; 
@@ -418,38 +761,25 @@ remove(const char* file)
 int 
 open(const char* file)
 {
-  struct thread *cur = thread_current();
-  struct file *last_file = NULL;
   struct file *file_op = NULL;
+  int fd;
 
-  struct list_elem *iter = list_begin(&all_files);
-  while (iter != list_end(&all_files))
-  {
-    struct open_file *op_file = list_entry(iter, struct open_file, af);
-    if (strcmp(file, op_file->name) == 0){
-      last_file = op_file->tfiles;
-      break;
-    }
-    iter = list_next(iter);
-  }
-  
+  /* filesys_open() goes through the open inode table, so a file that is already 
+     open anywhere shares its inode instead of being read from disk again. */
   lock_acquire(&file_system_lock);
-  if (last_file != NULL)
-    file_op = file_reopen(last_file);
-  else 
-    file_op = filesys_open(file);
+  file_op = filesys_open(file);
   lock_release(&file_system_lock);
   
-  if(file_op != NULL){
-    struct open_file *op_file = malloc(sizeof(struct open_file));
-    op_file->fd = cur->fd_next++;
-    op_file->tfiles = file_op;
-    op_file->name = (char*)file;
-    list_push_back(&cur->files, &op_file->at);
-    list_push_back(&all_files, &op_file->af);
-    return op_file->fd;
+  if (file_op == NULL)
+    return -1;
+
+  fd = add_file(file_op);
+  if (fd == -1){
+    lock_acquire(&file_system_lock);
+    file_close(file_op);
+    lock_release(&file_system_lock);
   }
-  return -1;
+  return fd;
 }
 
 int 
@@ -468,21 +798,100 @@ filesize(int fd)
 }
 
 /* 
-  Searches fd file in current thread file list and returns open_file pointer if fd is on the list. 
-  If fd file is not on the list, then return NULL pointer.
+  Returns the open_file of fd in the current thread's file descriptor table. 
+  If fd is not open, then return NULL pointer.
 */
 struct open_file 
 *get_file(int fd){
-    struct list * opfiles = &thread_current()->files;
-    struct list_elem *files= list_begin(opfiles);    
-    while (files != list_end(opfiles))
-    {   
-      struct open_file *opfile  = list_entry(files, struct open_file, at);
-      if (opfile->fd == fd)
-        return opfile;
-      files = list_next(files);
-    }
-    return NULL;
+    struct thread *cur = thread_current();
+    if (fd < 0 || (size_t) fd >= cur->fd_cap)
+      return NULL;
+    return cur->fd_table[fd];
+}
+
+/*
+  Puts FILE in the lowest free slot of the current thread's file descriptor table. 
+  The table is created on first use and doubled when full. 
+  Returns the new fd, or -1 if memory is exhausted.
+*/
+int 
+add_file(struct file *file)
+{
+  struct thread *cur = thread_current();
+  struct open_file *op_file;
+  size_t fd = BITMAP_ERROR;
+
+  if (cur->fd_map != NULL)
+    fd = bitmap_scan_and_flip(cur->fd_map, 0, 1, false);
+  if (fd == BITMAP_ERROR){
+    if (!grow_fd_table(cur))
+      return -1;
+    fd = bitmap_scan_and_flip(cur->fd_map, 0, 1, false);
+  }
+
+  op_file = malloc(sizeof(struct open_file));
+  if (op_file == NULL){
+    bitmap_reset(cur->fd_map, fd);
+    return -1;
+  }
+  op_file->fd = fd;
+  op_file->tfiles = file;
+  cur->fd_table[fd] = op_file;
+  return fd;
+}
+
+/* Doubles T's file descriptor table, or creates it with FD_TABLE_INIT slots. 
+   STDIN and STDOUT slots are always marked used. */
+static bool 
+grow_fd_table(struct thread *t)
+{
+  size_t cap = t->fd_cap ? t->fd_cap * 2 : FD_TABLE_INIT;
+  struct open_file **table;
+  struct bitmap *map;
+  size_t i;
+
+  map = bitmap_create(cap);
+  if (map == NULL)
+    return false;
+  table = realloc(t->fd_table, cap * sizeof *table);
+  if (table == NULL){
+    bitmap_destroy(map);
+    return false;
+  }
+
+  for (i = 0; i < cap; i++)
+    if (i < t->fd_cap)
+      bitmap_set(map, i, bitmap_test(t->fd_map, i));
+    else
+      table[i] = NULL;
+  bitmap_mark(map, STDIN_FILENO);
+  bitmap_mark(map, STDOUT_FILENO);
+
+  if (t->fd_map != NULL)
+    bitmap_destroy(t->fd_map);
+  t->fd_table = table;
+  t->fd_map = map;
+  t->fd_cap = cap;
+  return true;
+}
+
+/* Closes every file the current thread has open and frees its file descriptor table. */
+void 
+close_all_files(void)
+{
+  struct thread *cur = thread_current();
+  size_t fd;
+
+  for (fd = 0; fd < cur->fd_cap; fd++)
+    close(fd);
+  cur->fd_exec = -1;
+
+  free(cur->fd_table);
+  if (cur->fd_map != NULL)
+    bitmap_destroy(cur->fd_map);
+  cur->fd_table = NULL;
+  cur->fd_map = NULL;
+  cur->fd_cap = 0;
 }
 
 
@@ -493,8 +902,7 @@ read(int fd, char* buffer, unsigned size)
 
   struct thread *cur = thread_current(); 
 #ifdef VM
-  cur->fault_addr = buffer;
-  preload(buffer, size);
+  pin_buffer(buffer, size, true);
 #endif
   if (fd){    
     struct open_file *opened_file = get_file(fd);
@@ -523,10 +931,12 @@ write (int fd, void* buffer, unsigned size)
 
   struct thread *cur = thread_current(); 
 #ifdef VM
-  cur->fault_addr = buffer;
-  preload(buffer, size);
+  pin_buffer(buffer, size, false);
 #endif
   if (fd == STDIN_FILENO){
+#ifdef VM
+    unpin_frames(cur);
+#endif
     return 0;
   }
   else if (fd == STDOUT_FILENO){
@@ -538,8 +948,12 @@ write (int fd, void* buffer, unsigned size)
   }else{
     struct open_file *opfile = get_file(fd);
     int written_bytes = 0;
-    if (opfile == NULL)
+    if (opfile == NULL){
+#ifdef VM
+      unpin_frames(cur);
+#endif
       return 0;
+    }
     lock_acquire(&file_system_lock);
     written_bytes = file_write(opfile->tfiles, buffer, size);
     lock_release(&file_system_lock);
@@ -589,12 +1003,232 @@ close(int fd)
     lock_acquire(&file_system_lock);
     file_close(openfile->tfiles);
     lock_release(&file_system_lock);
-    list_remove(&openfile->at);
-    list_remove(&openfile->af);
+    thread_current()->fd_table[fd] = NULL;
+    bitmap_reset(thread_current()->fd_map, fd);
     free(openfile);
   }
 }
 
+/*
+  Copies the resource usage of the process with identifier pid, or of the calling 
+  process if pid is -1, to ustats. Returns false if there is no such process.
+*/
+bool 
+stats(pid_t pid, struct procstat *ustats)
+{
+  struct procstat s;
+  struct thread *t;
+
+  enum intr_level old_level = intr_disable();
+  t = pid == -1 ? thread_current() : get_thread(pid);
+  if (t != NULL)
+    thread_get_stats(t, &s);
+  intr_set_level(old_level);
+  if (t == NULL)
+    return false;
+
+#ifdef VM
+  s.frames = frame_owned_cnt(s.tid);
+#endif
+  copy_out(ustats, &s, sizeof s);
+  return true;
+}
+
+/*
+  Copies the resource usage of up to max threads, kernel threads included, to the 
+  array ubuf. Returns the number of threads, which may be more than max.
+*/
+int 
+stats_all(struct procstat *ubuf, int max)
+{
+  struct procstat *buf;
+  int cnt, i;
+
+  cnt = thread_get_all_stats(NULL, 0);
+  if (max > cnt)
+    max = cnt;
+  if (max <= 0)
+    return cnt;
+
+  buf = malloc(max * sizeof *buf);
+  if (buf == NULL)
+    return -1;
+  cnt = thread_get_all_stats(buf, max);
+  for (i = 0; i < max && i < cnt; i++)
+  {
+#ifdef VM
+    buf[i].frames = frame_owned_cnt(buf[i].tid);
+#endif
+    copy_out(ubuf + i, &buf[i], sizeof buf[i]);
+  }
+  free(buf);
+  return cnt;
+}
+
+/*
+  Reserves runtime_ms of CPU time in every period_ms for the calling process, to be
+  used within deadline_ms of the start of each period, or drops the reservation if
+  runtime_ms is 0. Times are rounded to timer ticks, the runtime up and the others
+  down. Returns false if the reservation is invalid or does not fit.
+*/
+bool 
+sched_deadline(unsigned runtime_ms, unsigned deadline_ms, unsigned period_ms)
+{
+  int64_t runtime = DIV_ROUND_UP((int64_t) runtime_ms * TIMER_FREQ, 1000);
+  int64_t deadline = (int64_t) deadline_ms * TIMER_FREQ / 1000;
+  int64_t period = (int64_t) period_ms * TIMER_FREQ / 1000;
+
+  return thread_set_deadline(runtime, deadline, period);
+}
+
+/*
+  Reads size bytes at byte offset of file fd into buffer, without moving the file 
+  position. Returns the number of bytes read, or -1 if fd is not an open file.
+*/
+int 
+pread(int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct iovec iov = {buffer, size};
+
+  if ((off_t) offset < 0)
+    return -1;
+  return transfer(fd, &iov, 1, offset, false);
+}
+
+/*
+  Writes size bytes from buffer at byte offset of file fd, without moving the file 
+  position. Returns the number of bytes written, or -1 if fd is not an open file.
+*/
+int 
+pwrite(int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  struct iovec iov = {(void*) buffer, size};
+
+  if ((off_t) offset < 0)
+    return -1;
+  return transfer(fd, &iov, 1, offset, true);
+}
+
+/*
+  Reads from fd into the iovcnt buffers listed at uiov, in order, as one read. Returns 
+  the number of bytes read, or -1 if fd is not open or iovcnt is out of range.
+*/
+int 
+readv(int fd, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec iov[IOV_MAX];
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+  copy_in(iov, uiov, iovcnt * sizeof *iov);
+  return transfer(fd, iov, iovcnt, -1, false);
+}
+
+/*
+  Writes the iovcnt buffers listed at uiov to fd, in order, as one write. Returns the 
+  number of bytes written, or -1 if fd is not open or iovcnt is out of range.
+*/
+int 
+writev(int fd, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec iov[IOV_MAX];
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+  copy_in(iov, uiov, iovcnt * sizeof *iov);
+  return transfer(fd, iov, iovcnt, -1, true);
+}
+
+/*
+  Reads fd into, or if write is true writes it from, the iovcnt user buffers in iov, 
+  starting at byte ofs of the file, or at the file position if ofs is -1. The buffers 
+  are checked, or with VM pinned, and transferred TRANSFER_CHUNK bytes at a time, so a 
+  large request never holds more than a few frames. Stops at the first short transfer. 
+  Returns the number of bytes transferred, or -1 if fd is not open for it or the buffers 
+  add up to more than INT_MAX bytes.
+*/
+static int 
+transfer(int fd, const struct iovec *iov, int iovcnt, off_t ofs, bool write)
+{
+  struct open_file *opened_file = NULL;
+  size_t total = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+  {
+    if (iov[i].iov_len == 0)
+      continue;
+    if (iov[i].iov_base == NULL || !is_user_vaddr(iov[i].iov_base))
+      exit(-1);
+    if (iov[i].iov_len > INT_MAX - total)
+      return -1;
+    total += iov[i].iov_len;
+  }
+
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO)
+  {
+    /* The console has no offsets and goes one way only. */
+    if (ofs != -1 || write != (fd == STDOUT_FILENO))
+      return -1;
+  }
+  else if ((opened_file = get_file(fd)) == NULL)
+    return -1;
+
+  total = 0;
+  for (i = 0; i < iovcnt; i++)
+  {
+    uint8_t *buffer = iov[i].iov_base;
+    size_t left = iov[i].iov_len;
+
+    while (left > 0)
+    {
+      off_t size = left < TRANSFER_CHUNK ? left : TRANSFER_CHUNK;
+      off_t n, j;
+
+      /* A bad page kills the process, after pin_buffer() unpins what it pinned. */
+#ifdef VM
+      pin_buffer(buffer, size, !write);
+#else
+      check_buffer(buffer, size, !write);
+#endif
+      if (opened_file == NULL)
+      {
+        if (write)
+          putbuf((const char*) buffer, size);
+        else
+          for (j = 0; j < size; j++)
+            buffer[j] = input_getc();
+        n = size;
+      }
+      else
+      {
+        struct file *file = opened_file->tfiles;
+
+        lock_acquire(&file_system_lock);
+        if (ofs == -1)
+          n = write ? file_write(file, buffer, size) : file_read(file, buffer, size);
+        else
+        {
+          n = write ? file_write_at(file, buffer, size, ofs) 
+                    : file_read_at(file, buffer, size, ofs);
+          ofs += n;
+        }
+        lock_release(&file_system_lock);
+      }
+#ifdef VM
+      unpin_frames(thread_current());
+#endif
+
+      total += n;
+      if (n < size)
+        return total;
+      buffer += n;
+      left -= n;
+    }
+  }
+  return total;
+}
+
 #ifdef VM
 bool check_overlap(struct hash *mmtable, void *base, int length);
 bool check_overlap_existing(void *base, int length); 
@@ -807,87 +1441,30 @@ delete_children(struct hash_elem *elem, void *aux UNUSED)
 }
 
 #ifdef VM
-int calc_pages(void *upage, size_t size)
-{
-  size_t allocated = 0;
-  size_t last_increment = 0;
-  int pages = 0;
-  while (allocated < size )
-  {
-    if (allocated + PGSIZE > size){
-      allocated += size - allocated;
-      last_increment = size - allocated; 
-      upage += last_increment;
-    }else{
-      allocated += PGSIZE; 
-      last_increment = PGSIZE; 
-      upage += last_increment;
-    }
-    pages++; 
-  }
-
-  return pages + 1 ; 
-  
-}
 /*
-  Preload pages for read/write syscalls. When preloading pages there are two cases: 
-   1. All of buffer pages are already created. But they may be in swap, loaded or in file. 
-   2. Pages need to be created with stack growth.
+  Pins every page of BUFFER for read/write syscalls, so the frames stay resident while the 
+  file system copies into or out of them. pin_page() loads pages from file or swap, or grows 
+  the stack, as needed; resident pages are pinned straight from their page entry. WRITE is 
+  true when the kernel will write into BUFFER. The frames are released with unpin_frames(). 
+  Kills the process if any page is not valid for the access.
 */
 static void 
-preload(void *fault_address, size_t size)
+pin_buffer(const void *buffer, size_t size, bool write)
 {
-  ASSERT(is_user_vaddr(fault_address))
-
   struct thread *cur = thread_current(); 
-  struct spage_entry *page = NULL;
-  void *buffer = fault_address;
-  int i = 0;
-  size_t allocated = 0;
-  int cant_pages =  calc_pages(fault_address, size);
-  while (i != cant_pages)
-  {
-    size_t page_size = (allocated + PGSIZE > size)? size - allocated: PGSIZE; 
-    allocated += page_size; 
-    /* If page is already loaded, then continue to the next iteration because there is no point in stack growth or page reclamation */
-    if (pagedir_get_page(cur->pagedir, buffer) != NULL){
-      buffer += page_size;
-      i++; 
-      continue; 
-    }
+  const uint8_t *addr = buffer;
+  const uint8_t *end = addr + size;
 
-    /* Search the page in supplementary page table. If we found the page and is not loaded then load the page from file or swap. If we don't find 
-    the page then need to grow the stack. */
-    page= lookup_page(cur, pg_round_down(buffer));
-    bool success = false;
-    if (page != NULL && !page->loaded){
-      switch (page->type)
-      {
-      case EXECUTABLE:
-         success = load_file_page(page);
-         return;
-      case PAGE:
-         success = load_page(page);
-         break;
-      }
-    }else if (page == NULL && (cur->esp - 32)  <= buffer){
-      success = stack_growth(buffer);
-    }else{
+  if (end < addr)
+    exit(-1);
+  while (addr < end)
+  {
+    if (pin_page(addr, write) == NULL){
+      unpin_frames(cur);
       exit(-1);
     }
-
-    if (!success)
-      PANIC("No se logro cargar la página.");
-
-    struct frame_entry* fte = lookup_uframe(cur, pg_round_down(buffer)); 
-    if (fte == NULL)
-      PANIC("No hay memoria para precargar el buffer"); 
-    
-    fte->pinned = true;
-
-    buffer += page_size;
-    i++; 
+    addr = (const uint8_t*) pg_round_down(addr) + PGSIZE;
   }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -5,9 +5,15 @@ typedef int pid_t;
 typedef int mapid_t;
 #endif
 
-static struct lock file_system_lock;
+struct file;
+struct iovec;
+struct procstat;
+
+extern struct lock file_system_lock;
 void syscall_init (void);
 struct open_file * get_file(int fd);
+int add_file(struct file *file);
+void close_all_files(void);
 void exit(int status);
 pid_t exec(const char* cmd_line);
 bool create(const char* file, unsigned initial_size);
@@ -19,6 +25,13 @@ int write (int fd, void* buffer, unsigned size);
 void seek(int fd, unsigned position);
 unsigned tell (int fd);
 void close(int fd);
+bool stats(pid_t pid, struct procstat *ustats);
+int stats_all(struct procstat *ubuf, int max);
+bool sched_deadline(unsigned runtime_ms, unsigned deadline_ms, unsigned period_ms);
+int pread(int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset);
+int readv(int fd, const struct iovec *uiov, int iovcnt);
+int writev(int fd, const struct iovec *uiov, int iovcnt);
 
 #ifdef VM
 mapid_t mmap(int fd, void *addr); 
@@ -3,6 +3,7 @@
 #include <stddef.h>
 #include "userprog/gdt.h"
 #include "threads/thread.h"
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
@@ -75,6 +76,23 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* Stack sysenter enters on, see tss_enable_sysenter().  Its top
+   word holds the address of the TSS's esp0. */
+static uint32_t *sysenter_stack;
+
+/* Model-specific registers that set up sysenter. */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Stack pointer on entry. */
+#define MSR_SYSENTER_EIP 0x176  /* Entry point. */
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" ((uint32_t) value),
+                "d" ((uint32_t) (value >> 32)));
+}
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -104,3 +122,22 @@ tss_update (void)
   ASSERT (tss != NULL);
   tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
 }
+
+/* Makes the sysenter instruction jump to ENTRY in the kernel code
+   segment.  sysenter takes its stack pointer from an MSR, not
+   from the TSS, and writing an MSR on every thread switch is
+   slow.  So the MSR is set once, to a fixed stack whose top word
+   holds the address of esp0, and ENTRY loads the thread's kernel
+   stack from there itself.  A debug trap or NMI taken before
+   that lands on the fixed stack, which has a page of room. */
+void
+tss_enable_sysenter (void (*entry) (void)) 
+{
+  ASSERT (tss != NULL);
+  sysenter_stack = palloc_get_page (PAL_ASSERT);
+  sysenter_stack[PGSIZE / sizeof *sysenter_stack - 1] = (uint32_t) &tss->esp0;
+  wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+  wrmsr (MSR_SYSENTER_ESP,
+         (uint32_t) &sysenter_stack[PGSIZE / sizeof *sysenter_stack - 1]);
+  wrmsr (MSR_SYSENTER_EIP, (uint32_t) entry);
+}
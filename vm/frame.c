@@ -1,15 +1,18 @@
 #include "vm/frame.h"
 #include "vm/swap.h"
 #include "vm/spage.h"
+#include "vm/share.h"
 
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 
 #include "userprog/process.h"
 #include "userprog/pagedir.h"
+#include "userprog/exception.h"
 
 #include "devices/timer.h"
 #include "stdio.h"
@@ -18,8 +21,10 @@
 
 
 struct frame_entry *lookup_eviction_victim(void);
-struct frame_entry *lookup_frame(void *frame); 
+static struct frame_entry *find_frame(void *frame);
 
+/* Signaled with evict_lock when a thread's last page being swapped out is done. */
+static struct condition evict_done; 
 
 void 
 frame_init()
@@ -27,6 +32,7 @@ frame_init()
     list_init(&frame_table);
     lock_init(&lock_frame);
     lock_init(&evict_lock);
+    cond_init(&evict_done);
 }
 
 
@@ -44,8 +50,9 @@ create_frame()
         
         new_frame->frame = frame; 
         new_frame->owner = thread_current();
-        new_frame->accessed_time = timer_ticks();
+        new_frame->accessed_time = clock_cycles();
         new_frame->pinned = false; 
+        new_frame->shared = NULL; 
 
         lock_acquire(&lock_frame);
             list_push_back(&frame_table, &new_frame->elem);
@@ -53,7 +60,7 @@ create_frame()
     }else { 
         struct frame_entry *new_frame = evict_frame(); 
         new_frame->owner = thread_current();
-        new_frame->accessed_time = timer_ticks(); 
+        new_frame->accessed_time = clock_cycles(); 
         new_frame->pinned = false; 
         frame = new_frame->frame;
         
@@ -73,8 +80,13 @@ install_frame(void *frame, void *upage, bool writable)
 {
     struct frame_entry *fte = lookup_frame(frame); 
     bool success = install_page(upage, frame, writable); 
-    if (success)
+    if (success){
         fte->upage = upage; 
+        /* Remember the frame in the page entry so pin_page() finds it without a frame table walk. */
+        struct spage_entry *page = lookup_page(thread_current(), upage); 
+        if (page)
+            page->fte = fte; 
+    }
     return success;
 }
 
@@ -84,12 +96,16 @@ install_frame(void *frame, void *upage, bool writable)
 void
 destroy_frame(void *frame)
 {
-    struct frame_entry *fte = lookup_frame(frame); 
+    struct frame_entry *fte; 
+
+    /* Found and removed in one hold, so nobody else can free the entry in between. */
+    lock_acquire(&lock_frame);
+        fte = find_frame(frame); 
+        if (fte)
+            list_remove(&fte->elem); 
+    lock_release(&lock_frame);
     if (fte)
     { 
-        lock_acquire(&lock_frame);
-            list_remove(&fte->elem); 
-        lock_release(&lock_frame);
         palloc_free_page(fte->frame); 
         free(fte); 
     }
@@ -101,16 +117,21 @@ struct frame_entry
 *lookup_frame(void *frame)
 {
     lock_acquire(&lock_frame);
+    struct frame_entry *fte = find_frame(frame); 
+    lock_release(&lock_frame); 
+    return fte; 
+}
+
+/* Same as lookup_frame(), but the caller must hold lock_frame. */
+static struct frame_entry *
+find_frame(void *frame)
+{
     struct list_elem *iter = list_begin(&frame_table); 
-    while (iter != list_end(&frame_table)){
+    for (; iter != list_end(&frame_table); iter = list_next(iter)){
         struct frame_entry *fte = list_entry(iter, struct frame_entry, elem); 
-        if (fte->frame == frame){
-            lock_release(&lock_frame); 
+        if (fte->frame == frame)
             return fte; 
-        }
-        iter = list_next(iter); 
     }
-    lock_release(&lock_frame); 
     return NULL; 
 }
 
@@ -118,28 +139,56 @@ struct frame_entry
 struct frame_entry *evict_frame(void)
 {
     struct frame_entry *frame;
+    struct spage_entry *page = NULL;
+    struct thread *owner; 
     lock_acquire(&evict_lock);
-        frame = lookup_eviction_victim(); 
+        /* The victim leaves the table in the same hold it was chosen in. */
+        lock_acquire(&lock_frame);
+            frame = lookup_eviction_victim(); 
+            if (frame)
+                list_remove(&frame->elem); 
+        lock_release(&lock_frame);
         if (!frame)
             PANIC("ERROR! NO FRAME TO EVICT");
-        list_remove(&frame->elem); 
+        TRACE(TRACE_EVICT, frame->frame, frame->upage, frame->owner->tid);
+
+        /* Pages are marked unloaded while holding evict_lock, so pin_page() never pins a frame 
+           that is on its way out. Shared executable frames are clean, just unmap them from every process. */
+        if (frame->shared)
+            share_evict(frame); 
+        else{
+            page = lookup_page(frame->owner, frame->upage);
+            page->loaded = false;
+            /* The owner's page table is used below without evict_lock, keep it alive. */
+            frame->owner->evicting++; 
+        }
     lock_release(&evict_lock);
 
-    struct spage_entry *page = lookup_page(frame->owner, frame->upage);
+    if (page == NULL){
+        memset(frame->frame, 0, PGSIZE);
+        return frame; 
+    }
+
     size_t idx = -1; 
     bool in_swap = false;
-    if (pagedir_is_dirty(frame->owner->pagedir, page->upage)){
+    owner = frame->owner; 
+    if (pagedir_is_dirty(owner->pagedir, page->upage)){
         idx = swap_allocate(frame->upage);
         in_swap = true;
+        owner->stats.swap_outs++;
     }
 
     memset(frame->frame, 0, PGSIZE);
 
     page->swap_id = idx; 
     page->in_swap = in_swap; 
-    page->loaded = false;
 
-    pagedir_clear_page(frame->owner->pagedir, frame->upage);
+    pagedir_clear_page(owner->pagedir, frame->upage);
+
+    lock_acquire(&evict_lock);
+        if (--owner->evicting == 0)
+            cond_broadcast(&evict_done, &evict_lock);
+    lock_release(&evict_lock);
     return frame;
 }
 
@@ -148,18 +197,20 @@ struct frame_entry*
 lookup_eviction_victim(void)
 {
     struct frame_entry *victim = NULL; 
-    uint64_t ticks = timer_ticks();
+    uint64_t now = clock_cycles();
 
     struct list_elem *iter = list_begin(&frame_table); 
     for (; iter != list_end(&frame_table); iter = list_next(iter))
     {
         struct frame_entry *candidate = list_entry(iter, struct frame_entry, elem);
+        if (candidate->pinned || (candidate->shared && candidate->shared->pinned > 0))
+            continue; 
         if (!victim){
             victim = candidate; 
             continue;
         }
 
-        if (!candidate->pinned &&  (ticks - victim->accessed_time) < (ticks -  candidate->accessed_time))
+        if ((now - victim->accessed_time) < (now - candidate->accessed_time))
             victim = candidate;
     }
 
@@ -188,20 +239,130 @@ struct frame_entry
 
 
 /*
-    Unpins all the pinned frames of thread t.
+    Makes the page holding UADDR in the current process resident and pins its frame so it cannot 
+    be evicted while the kernel accesses it. Loads the page from file or swap, or grows the 
+    stack, if needed. If WRITE is true, copy-on-write pages get their private copy first. 
+
+    The frame is added to the thread's pinned_frames list and stays pinned until unpin_frames(). 
+    Returns the frame entry, or NULL if UADDR is not a valid address for the access. 
+*/
+struct frame_entry *
+pin_page(const void *uaddr, bool write)
+{
+    struct thread *cur = thread_current(); 
+    struct frame_entry *fte = NULL; 
+    void *upage = pg_round_down(uaddr); 
+
+    for (;;)
+    {
+        struct spage_entry *page = lookup_page(cur, upage); 
+        bool success = true; 
+
+        if (page == NULL){
+            /* Stack growth, same heuristic as the page fault handler. */
+            if (uaddr == NULL || !is_user_vaddr(uaddr) || uaddr < cur->esp - 32)
+                return NULL; 
+            if (!stack_growth((void*) uaddr))
+                return NULL; 
+            continue; 
+        }
+        if (write && !page->writable)
+            return NULL; 
+
+        if (!page->loaded){
+            switch (page->type)
+            {
+            case MMFILE:
+            case EXECUTABLE:
+                success = load_file_page(page);
+                break;
+            case PAGE:
+                success = load_page(page);
+                break;
+            }
+        }
+        if (success && write && page->cow)
+            success = share_break_cow(page); 
+        if (!success)
+            return NULL; 
+
+        /* The page may have been evicted again before we got evict_lock, then just retry. */
+        lock_acquire(&evict_lock);
+        if (page->loaded && !(write && page->cow))
+            fte = page->fte; 
+        if (fte != NULL && !fte->pinned){
+            fte->pinned = true; 
+            if (fte->shared)
+                fte->shared->pinned++; 
+            list_push_back(&cur->pinned_frames, &fte->pin_elem); 
+        }
+        lock_release(&evict_lock);
+
+        if (fte != NULL)
+            return fte; 
+    }
+}
+
+/*
+    Unpins all the frames pinned by thread t with pin_page().
 */
 void 
 unpin_frames(struct thread *t)
 {
-    lock_acquire(&lock_frame);
-    struct list_elem *iter = list_begin(&frame_table); 
-    while (iter != list_end(&frame_table)){
-        struct frame_entry *fte = list_entry(iter, struct frame_entry, elem); 
-        if (fte->owner == t && fte->pinned){
-            fte->pinned = false;
-        }
-        iter = list_next(iter); 
+    lock_acquire(&evict_lock);
+    while (!list_empty(&t->pinned_frames)){
+        struct frame_entry *fte = list_entry(list_pop_front(&t->pinned_frames), struct frame_entry, pin_elem); 
+        fte->pinned = false;
+        if (fte->shared)
+            fte->shared->pinned--; 
     }
-    lock_release(&lock_frame); 
+    lock_release(&evict_lock);
+}
 
-}
\ No newline at end of file
+/*
+    Returns the number of frames resident for the thread with identifier tid, shared ones included.
+*/
+size_t
+frame_owned_cnt(tid_t tid)
+{
+    size_t cnt = 0;
+
+    lock_acquire(&lock_frame);
+        struct list_elem *iter = list_begin(&frame_table);
+        for (; iter != list_end(&frame_table); iter = list_next(iter))
+            if (list_entry(iter, struct frame_entry, elem)->owner->tid == tid)
+                cnt++;
+    lock_release(&lock_frame);
+    return cnt;
+}
+
+/*
+    Drops every frame entry of the exiting process T. The frames themselves are freed by 
+    pagedir_destroy(), shared ones by share_release() with their last mapping. Waits for the 
+    evictions of T's pages still writing to swap, then unlinks everything while holding 
+    evict_lock, so no eviction touches T's page directory or supplemental page table once 
+    they are being destroyed. 
+*/
+void
+frame_exit(struct thread *t)
+{
+    unpin_frames(t);
+
+    lock_acquire(&evict_lock);
+        while (t->evicting > 0)
+            cond_wait(&evict_done, &evict_lock);
+        share_release(t);
+
+        lock_acquire(&lock_frame);
+            struct list_elem *iter = list_begin(&frame_table);
+            while (iter != list_end(&frame_table)){
+                struct frame_entry *fte = list_entry(iter, struct frame_entry, elem);
+                iter = list_next(iter);
+                if (fte->owner == t){
+                    list_remove(&fte->elem);
+                    free(fte);
+                }
+            }
+        lock_release(&lock_frame);
+    lock_release(&evict_lock);
+}
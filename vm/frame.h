@@ -5,10 +5,11 @@
 #include <list.h>
 #include <hash.h>
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include <stdint.h>
 
 struct list frame_table; 
-struct lock lock_frame; 
+struct lock lock_frame;                     /* Protects frame_table. */
 struct lock evict_lock;
 
 /*
@@ -28,6 +29,10 @@ struct frame_entry
     // Save if it is data, file or executable. 
     // Save if it is pinned.
 
+    struct shared_frame *shared;    /* Executable frame shared with other processes, or NULL. */
+    struct list_elem share_elem;    /* Element in shared->entries. */
+    struct list_elem pin_elem;      /* Element in owner->pinned_frames while pinned. */
+
     struct list_elem elem; 
 };
 
@@ -38,6 +43,10 @@ bool install_frame(void *frame, void* upage, bool writable);
 void destroy_frame(void *frame); 
 struct frame_entry* evict_frame(void);
 struct frame_entry* lookup_uframe(struct thread *t, void *upage); 
+struct frame_entry* lookup_frame(void *frame); 
+struct frame_entry* pin_page(const void *uaddr, bool write); 
 void unpin_frames(struct thread *t);
+size_t frame_owned_cnt(tid_t tid);
+void frame_exit(struct thread *t);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,332 @@
+#include "vm/share.h"
+#include "vm/frame.h"
+#include "vm/spage.h"
+
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+#include "userprog/process.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+
+#include "filesys/file.h"
+#include "filesys/inode.h"
+
+#include "devices/timer.h"
+#include "string.h"
+#include "debug.h"
+
+/* Shared executable frames, keyed by (inode, ofs, read_bytes). */
+static struct hash shared_frames; 
+/* Protects shared_frames and the entries list of every shared frame. 
+   Lock order: evict_lock, lock_share, lock_frame; file_system_lock nests inside lock_share. */
+static struct lock lock_share; 
+
+static struct shared_frame *lookup_shared(struct file_page *file_); 
+static bool map_shared(struct shared_frame *sf, struct spage_entry *page, struct frame_entry *fte); 
+static void unlink_shared(struct frame_entry *fte); 
+static void drop_shared(struct shared_frame *sf); 
+static bool read_page(struct file_page *file_, void *kpage); 
+
+static unsigned
+share_hash(const struct hash_elem *elem_, void *aux UNUSED)
+{
+    const struct shared_frame *sf = hash_entry(elem_, struct shared_frame, elem);
+    return hash_bytes(&sf->inode, sizeof sf->inode) ^ hash_int(sf->ofs) ^ hash_int(sf->read_bytes); 
+}
+
+static bool
+share_hash_less(const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED)
+{
+    const struct shared_frame *a = hash_entry(a_, struct shared_frame, elem);
+    const struct shared_frame *b = hash_entry(b_, struct shared_frame, elem);
+    if (a->inode != b->inode)
+        return a->inode < b->inode; 
+    if (a->ofs != b->ofs)
+        return a->ofs < b->ofs; 
+    return a->read_bytes < b->read_bytes; 
+}
+
+/* Initializes the shared frame table. Needs malloc(), so it runs after frame_init(). */
+void 
+share_init(void)
+{
+    hash_init(&shared_frames, share_hash, share_hash_less, NULL); 
+    lock_init(&lock_share); 
+}
+
+/*
+    Loads an executable page by mapping the frame every other process running the same 
+    binary already uses. If no process has the page yet, it is read from the file into a 
+    new frame that later loads will share. Writable pages are mapped read-only and marked 
+    copy-on-write. 
+*/
+bool 
+share_load_page(struct spage_entry *page)
+{
+    ASSERT(page->type == EXECUTABLE);
+
+    struct file_page *file_ = page->file; 
+    struct shared_frame *sf; 
+    bool success; 
+
+    lock_acquire(&lock_share);
+    sf = lookup_shared(file_); 
+    if (sf){
+        success = map_shared(sf, page, NULL); 
+        lock_release(&lock_share);
+        return success; 
+    }
+    lock_release(&lock_share);
+
+    /* Not resident yet. create_frame() may evict, and eviction takes lock_share, so the 
+       page is read without holding it. */
+    void *kpage = create_frame(); 
+    if (kpage == NULL)
+        return false; 
+    if (!read_page(file_, kpage))
+    {
+        destroy_frame(kpage); 
+        return false;
+    }
+    thread_current()->stats.major_faults++;
+
+    lock_acquire(&lock_share);
+    sf = lookup_shared(file_); 
+    if (sf){
+        /* Someone else loaded the same page meanwhile, use theirs. */
+        success = map_shared(sf, page, NULL);
+        lock_release(&lock_share);
+        destroy_frame(kpage);
+        return success; 
+    }
+
+    sf = (struct shared_frame*) malloc(sizeof(struct shared_frame)); 
+    if (!sf){
+        lock_release(&lock_share);
+        destroy_frame(kpage); 
+        return false; 
+    }
+    /* The key must outlive every process that has the executable open. */
+    sf->inode = inode_reopen(file_get_inode(file_->file)); 
+    sf->ofs = file_->ofs; 
+    sf->read_bytes = file_->read_bytes; 
+    sf->frame = kpage; 
+    sf->refs = 0; 
+    sf->pinned = 0; 
+    list_init(&sf->entries);
+    hash_insert(&shared_frames, &sf->elem); 
+
+    /* The frame entry create_frame() made becomes the first mapping. */
+    success = map_shared(sf, page, lookup_frame(kpage)); 
+    lock_release(&lock_share);
+    return success; 
+}
+
+/*
+    Gives the process its own writable copy of a copy-on-write page. Called from the page 
+    fault handler on the first write to PAGE. Returns false if PAGE is not copy-on-write 
+    or memory could not be allocated. 
+*/
+bool 
+share_break_cow(struct spage_entry *page)
+{
+    struct thread *cur = thread_current(); 
+
+    if (!page->cow)
+        return false; 
+
+    void *kpage = create_frame(); 
+    if (kpage == NULL)
+        return false; 
+
+    lock_acquire(&lock_share);
+    struct frame_entry *fte = page->loaded ? page->fte : NULL; 
+    if (fte != NULL && fte->shared != NULL){
+        memcpy(kpage, fte->shared->frame, PGSIZE); 
+        pagedir_clear_page(cur->pagedir, page->upage); 
+        lock_acquire(&lock_frame);
+            list_remove(&fte->elem);
+        lock_release(&lock_frame);
+        unlink_shared(fte);
+        lock_release(&lock_share);
+    }else{
+        /* The shared frame was evicted while we allocated, read the page again. */
+        struct file_page *file_ = page->file; 
+        lock_release(&lock_share);
+        pagedir_clear_page(cur->pagedir, page->upage);
+        if (!read_page(file_, kpage))
+        {
+            destroy_frame(kpage); 
+            return false;
+        }
+    }
+
+    page->cow = false; 
+    if (!install_frame(kpage, page->upage, true)){
+        page->loaded = false; 
+        destroy_frame(kpage); 
+        return false; 
+    }
+    page->loaded = true; 
+    return true; 
+}
+
+/*
+    Drops every mapping T holds on a shared frame when T exits. The user mappings are 
+    cleared so pagedir_destroy() does not free pages other processes still use, a page is 
+    freed with its last mapping. Called with evict_lock held, so share_evict() cannot be 
+    unmapping the same entries. 
+*/
+void 
+share_release(struct thread *t)
+{
+    lock_acquire(&lock_share);
+    lock_acquire(&lock_frame);
+    struct list_elem *iter = list_begin(&frame_table); 
+    while (iter != list_end(&frame_table))
+    {
+        struct frame_entry *fte = list_entry(iter, struct frame_entry, elem); 
+        iter = list_next(iter); 
+        if (fte->owner != t || fte->shared == NULL)
+            continue; 
+        list_remove(&fte->elem); 
+        if (t->pagedir != NULL)
+            pagedir_clear_page(t->pagedir, fte->upage); 
+        unlink_shared(fte);
+    }
+    lock_release(&lock_frame);
+    lock_release(&lock_share);
+}
+
+/*
+    Evicts a shared frame. VICTIM, already out of the frame table, is kept so evict_frame() 
+    can hand it to the caller. Called with evict_lock held, which also keeps exiting owners 
+    from tearing down their page tables meanwhile. Every other mapping is removed from its 
+    process: executable pages are never dirty in the shared frame, they are simply read 
+    again on the next fault. 
+*/
+void 
+share_evict(struct frame_entry *victim)
+{
+    ASSERT(victim->shared != NULL);
+
+    lock_acquire(&lock_share);
+    struct shared_frame *sf = victim->shared; 
+    while (!list_empty(&sf->entries))
+    {
+        struct frame_entry *fte = list_entry(list_pop_front(&sf->entries), struct frame_entry, share_elem); 
+        struct spage_entry *page = lookup_page(fte->owner, fte->upage); 
+        if (page){
+            page->loaded = false; 
+            page->fte = NULL; 
+        }
+        pagedir_clear_page(fte->owner->pagedir, fte->upage); 
+        fte->shared = NULL; 
+        if (fte != victim){
+            lock_acquire(&lock_frame);
+                list_remove(&fte->elem);
+            lock_release(&lock_frame);
+            free(fte); 
+        }
+    }
+    drop_shared(sf); 
+    lock_release(&lock_share);
+}
+
+/* Searches the shared frame holding FILE_'s page. Must hold lock_share. */
+static struct shared_frame *
+lookup_shared(struct file_page *file_)
+{
+    struct shared_frame key; 
+    key.inode = file_get_inode(file_->file); 
+    key.ofs = file_->ofs; 
+    key.read_bytes = file_->read_bytes; 
+
+    struct hash_elem *e = hash_find(&shared_frames, &key.elem); 
+    if (e == NULL)
+        return NULL; 
+    return hash_entry(e, struct shared_frame, elem); 
+}
+
+/*
+    Maps SF into the current process at PAGE's user address, read-only. FTE is the frame 
+    entry to use for the mapping, or NULL to create one. Must hold lock_share. 
+*/
+static bool 
+map_shared(struct shared_frame *sf, struct spage_entry *page, struct frame_entry *fte)
+{
+    if (fte == NULL){
+        fte = (struct frame_entry*) malloc(sizeof(struct frame_entry)); 
+        if (!fte)
+            return false;
+        fte->frame = sf->frame; 
+        fte->owner = thread_current(); 
+        fte->accessed_time = clock_cycles();
+        fte->pinned = false; 
+        lock_acquire(&lock_frame);
+            list_push_back(&frame_table, &fte->elem);
+        lock_release(&lock_frame);
+    }
+    fte->upage = page->upage; 
+    fte->shared = sf; 
+    list_push_back(&sf->entries, &fte->share_elem); 
+    sf->refs++; 
+
+    if (!install_page(page->upage, sf->frame, false)){
+        lock_acquire(&lock_frame);
+            list_remove(&fte->elem);
+        lock_release(&lock_frame);
+        unlink_shared(fte); 
+        return false; 
+    }
+
+    page->cow = page->writable; 
+    page->fte = fte; 
+    page->loaded = true; 
+    return true; 
+}
+
+/* Removes FTE from its shared frame and frees it, freeing the frame too if FTE was the 
+   last mapping. FTE must be out of the frame table. Must hold lock_share. */
+static void 
+unlink_shared(struct frame_entry *fte)
+{
+    struct shared_frame *sf = fte->shared; 
+
+    list_remove(&fte->share_elem); 
+    free(fte); 
+    if (--sf->refs == 0){
+        palloc_free_page(sf->frame); 
+        drop_shared(sf); 
+    }
+}
+
+/* Removes SF from the table and closes its inode. Must hold lock_share. */
+static void 
+drop_shared(struct shared_frame *sf)
+{
+    hash_delete(&shared_frames, &sf->elem); 
+    lock_acquire(&file_system_lock);
+        inode_close(sf->inode); 
+    lock_release(&file_system_lock);
+    free(sf); 
+}
+
+/* Reads FILE_'s page into KPAGE and zeroes the rest of it. Returns false on a short read. */
+static bool 
+read_page(struct file_page *file_, void *kpage)
+{
+    off_t n; 
+
+    lock_acquire(&file_system_lock);
+        n = file_read_at(file_->file, kpage, file_->read_bytes, file_->ofs); 
+    lock_release(&file_system_lock);
+    if (n != (off_t) file_->read_bytes)
+        return false; 
+    memset(kpage + file_->read_bytes, 0, file_->zero_bytes);
+    return true; 
+}
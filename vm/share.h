@@ -0,0 +1,39 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <debug.h>
+#include <list.h>
+#include <hash.h>
+#include "filesys/off_t.h"
+#include "vm/frame.h"
+#include "vm/spage.h"
+
+/*
+    A frame that holds a page of an executable file and is mapped by every process 
+    running that executable. It is keyed by (inode, ofs, read_bytes): two segments 
+    can start on the same file page but zero a different amount of it. 
+
+    Read-only pages stay shared until the frame is evicted. Writable pages are mapped 
+    read-only and get a private copy on the first write (copy-on-write). 
+*/
+struct shared_frame
+{
+    struct inode *inode;        /* Executable the page was read from, held open. */
+    off_t ofs;                  /* Offset of the page in INODE. */
+    uint32_t read_bytes;        /* Bytes read from INODE, the rest is zero. */
+
+    void *frame;                /* Kernel page holding the data. */
+    int refs;                   /* Number of frame entries mapping FRAME. */
+    int pinned;                 /* Number of pinned frame entries mapping FRAME. */
+    struct list entries;        /* frame_entry.share_elem of every mapping. */
+
+    struct hash_elem elem; 
+};
+
+void share_init(void);
+bool share_load_page(struct spage_entry *page);
+bool share_break_cow(struct spage_entry *page);
+void share_release(struct thread *t);
+void share_evict(struct frame_entry *victim);
+
+#endif
@@ -8,6 +8,7 @@
 #include "vm/spage.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/share.h"
 
 #include "threads/thread.h"
 #include "threads/malloc.h"
@@ -44,6 +45,8 @@ get_page(void *upage, bool writable)
     page->file = NULL;
     page->swap_id = -1; 
     page->in_swap = false; 
+    page->cow = false; 
+    page->fte = NULL; 
 
     hash_insert(&cur->sup_table, &page->elem); 
 
@@ -68,6 +71,8 @@ bool get_file_page(struct file *file, off_t ofs, uint32_t read_bytes, uint32_t z
     page->file = NULL;
     page->swap_id = -1; 
     page->in_swap = false; 
+    page->cow = false; 
+    page->fte = NULL; 
 
 
     struct file_page *file_entry = (struct file_page*) malloc(sizeof(struct file_page));
@@ -93,6 +98,10 @@ bool load_file_page(struct spage_entry *page)
     if (page->in_swap)
         return load_page(page);
 
+    /* Executable pages are shared between every process running the same binary. */
+    if (page->type == EXECUTABLE)
+        return share_load_page(page);
+
     struct file_page *file_ = page->file;
 
     void *kpage = create_frame();
@@ -109,6 +118,7 @@ bool load_file_page(struct spage_entry *page)
         return false;
     }
     memset (kpage + file_->read_bytes, 0, file_->zero_bytes);
+    thread_current()->stats.major_faults++;
 
     /* Add the page to the process's address space. */
     if (!install_frame(kpage, page->upage, file_->writable))
@@ -136,8 +146,11 @@ bool load_page(struct spage_entry *page)
     }
     
     /* Load page content from swap */
-    if (page->in_swap)
+    if (page->in_swap){
         swap_deallocate(page->upage, page->swap_id);
+        thread_current()->stats.swap_ins++;
+        thread_current()->stats.major_faults++;
+    }
 
 
     /* Update page variables */
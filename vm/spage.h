@@ -4,6 +4,7 @@
 #include <hash.h>
 #include "filesys/off_t.h"
 #include "threads/thread.h"
+#include "vm/frame.h"
 
 /*
     Save all the data related to the process executable file. This data is needed to 
@@ -46,12 +47,14 @@ struct spage_entry
     bool loaded;
     bool writable;
     bool in_swap; 
+    bool cow;           /* Mapped read-only from a shared frame, copied on first write. */
 
     size_t swap_id; 
 
     Page_Type type; 
 
     struct file_page *file;
+    struct frame_entry *fte;    /* Frame holding the page while loaded. */
 
     struct hash_elem elem; 
 };
@@ -1,5 +1,6 @@
 #include "swap.h"
 #include "devices/block.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "debug.h"
 #include "stdio.h"
@@ -32,6 +33,7 @@ swap_init(void)
 void 
 swap_read(void *frame, size_t idx)
 {
+    TRACE(TRACE_SWAP_IN, idx, frame, 0);
     for (int i = 0; i < 8; i++)
         block_read(global_swap_block, idx + i, frame + (i * BLOCK_SECTOR_SIZE)); 
 }
@@ -40,6 +42,7 @@ swap_read(void *frame, size_t idx)
 void 
 swap_write(void *frame, size_t idx)
 {
+    TRACE(TRACE_SWAP_OUT, idx, frame, 0);
     
     for (int i = 0; i < 8; i++)
         block_write(global_swap_block, idx + i, frame + (i * BLOCK_SECTOR_SIZE)); 